@@ -0,0 +1,63 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+
+ArenaBlock* newArenaBlock(size_t size) {
+  size_t header = (sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  ArenaBlock* block = (ArenaBlock*) malloc(header + size);
+  block->next = NULL;
+  block->size = size;
+  block->data = (char*) block + header;
+  return block;
+}
+
+void* arenaAlloc(Arena* arena, size_t size) {
+  ArenaBlock* block;
+  char *p;
+
+  size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  if ((size_t) (arena->end - arena->ptr) < size) {
+    // move on to the next kept block that is big enough, or chain a new one
+    block = (arena->current == NULL) ? arena->first : arena->current->next;
+    while ((block != NULL) && (block->size < size))
+      block = block->next;
+    if (block == NULL) {
+      block = newArenaBlock((size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE);
+      if (arena->current == NULL) {
+        block->next = arena->first;
+        arena->first = block;
+      } else {
+        block->next = arena->current->next;
+        arena->current->next = block;
+      }
+    }
+    arena->current = block;
+    arena->ptr = block->data;
+    arena->end = block->data + block->size;
+  }
+  p = arena->ptr;
+  arena->ptr += size;
+  return p;
+}
+
+void arenaReset(Arena* arena) {
+  arena->current = NULL;
+  arena->ptr = NULL;
+  arena->end = NULL;
+}
+
+void arenaFree(Arena* arena) {
+  while (arena->first != NULL) {
+    ArenaBlock* block = arena->first;
+    arena->first = block->next;
+    free(block);
+  }
+  arenaReset(arena);
+}
@@ -0,0 +1,37 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#define ARENA_BLOCK_SIZE 65536
+
+struct ArenaBlock_ {
+  struct ArenaBlock_ *next;
+  size_t size;
+  char *data;
+};
+
+typedef struct ArenaBlock_ ArenaBlock;
+
+// Bump allocator: everything allocated from an arena is released at once
+// by arenaReset(), which keeps the blocks for the next use.
+struct Arena_ {
+  ArenaBlock *first;
+  ArenaBlock *current;
+  char *ptr;
+  char *end;
+};
+
+typedef struct Arena_ Arena;
+
+void* arenaAlloc(Arena* arena, size_t size);
+void arenaReset(Arena* arena);
+void arenaFree(Arena* arena);
+
+#endif
@@ -0,0 +1,69 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+#include "context.h"
+
+#define AST_INITIAL_SIZE 1024
+
+void growAst(void) {
+  ctx->nodeCapacity = (ctx->nodeCapacity == 0) ? AST_INITIAL_SIZE : ctx->nodeCapacity * 2;
+  ctx->nodes = (AstNode*) realloc(ctx->nodes, ctx->nodeCapacity * sizeof(AstNode));
+  ctx->positions = (AstPosition*) realloc(ctx->positions, ctx->nodeCapacity * sizeof(AstPosition));
+}
+
+NodeId newNode(enum NodeKind kind, int lineNo, int colNo) {
+  NodeId id;
+
+  if (ctx->nodeCount == ctx->nodeCapacity)
+    growAst();
+  id = ctx->nodeCount ++;
+  memset(&ctx->nodes[id], 0, sizeof(AstNode));
+  ctx->nodes[id].kind = kind;
+  ctx->positions[id].lineNo = lineNo;
+  ctx->positions[id].colNo = colNo;
+  return id;
+}
+
+Type* nodeType(NodeId id) {
+  AstNode *node = AST_NODE(id);
+  Object *obj;
+
+  switch (node->kind) {
+  case AST_NUMBER:
+  case AST_NEGATE:
+  case AST_BINARY:
+    return makeIntType();
+  case AST_CHAR:
+    return makeCharType();
+  case AST_INDEX:
+    return node->type;
+  case AST_VARIABLE:
+  case AST_CALL:
+    obj = node->object;
+    switch (obj->kind) {
+    case OBJ_VARIABLE:
+      return obj->varAttrs->type;
+    case OBJ_PARAMETER:
+      return obj->paramAttrs->type;
+    case OBJ_FUNCTION:
+      return obj->funcAttrs->returnType;
+    default:
+      return NULL;
+    }
+  default:
+    return NULL;
+  }
+}
+
+// Releases every node at once; the pool is kept for the next compilation
+void resetAst(void) {
+  if (ctx->nodeCapacity == 0)
+    growAst();
+  ctx->nodeCount = 1;
+}
@@ -0,0 +1,72 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __AST_H__
+#define __AST_H__
+
+// The parser's output. Nodes live in one pool per compilation and refer to
+// each other by 32-bit ids; id 0 is "no node". Nodes are appended in source
+// order, so a pass that walks the tree moves forward through the pool.
+typedef unsigned int NodeId;
+
+struct Object_;
+struct Type_;
+
+enum NodeKind {
+  // statements
+  AST_ASSIGN,       // a := b
+  AST_CALL_ST,      // CALL object, arguments from a
+  AST_BLOCK,        // BEGIN statements from a END
+  AST_IF,           // IF a THEN b ELSE c
+  AST_WHILE,        // WHILE a DO b
+  AST_FOR,          // FOR a := b TO c DO body
+
+  // expressions
+  AST_NUMBER,       // value
+  AST_CHAR,         // value
+  AST_VARIABLE,     // object: a variable, a parameter or, as an lvalue, the current function
+  AST_INDEX,        // a(.b.), type is the element type
+  AST_CALL,         // object, arguments from a
+  AST_NEGATE,       // - a
+  AST_BINARY,       // a op b, op is SB_PLUS, SB_MINUS, SB_TIMES or SB_SLASH
+  AST_CONDITION     // a op b, op is a comparator
+};
+
+// flags
+#define NODE_IN_RANGE 0x01  // AST_INDEX: the index is known to be in range
+
+struct AstNode_ {
+  unsigned char kind;
+  unsigned char op;         // operator token of AST_BINARY and AST_CONDITION
+  unsigned char flags;
+  NodeId a, b, c;           // children, as listed for each kind
+  NodeId next;              // the next statement of a list, or the next argument
+  union {
+    int value;
+    NodeId body;
+    struct Object_ *object;
+    struct Type_ *type;
+  };
+};
+
+typedef struct AstNode_ AstNode;
+
+// Source positions are kept apart from the nodes; only diagnostics need them
+struct AstPosition_ {
+  int lineNo, colNo;
+};
+
+typedef struct AstPosition_ AstPosition;
+
+// The node with the given id in the current context (needs context.h).
+// The pool may move when a node is added, so do not keep the pointer.
+#define AST_NODE(id) (&ctx->nodes[id])
+
+NodeId newNode(enum NodeKind kind, int lineNo, int colNo);
+struct Type_* nodeType(NodeId id);
+void resetAst(void);
+
+#endif
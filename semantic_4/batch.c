@@ -0,0 +1,216 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "reader.h"
+#include "parser.h"
+#include "error.h"
+#include "context.h"
+#include "batch.h"
+
+#define MAX_THREADS 256
+#define NO_OUTPUT (-1)   // a job's status when its output could not be collected
+
+struct BatchJob_ {
+  char *fileName;
+  char *output;          // everything the compilation printed
+  size_t outputSize;
+  int status;            // IO_ERROR, IO_SUCCESS or NO_OUTPUT
+  int errorCount;
+  int done;
+};
+
+typedef struct BatchJob_ BatchJob;
+
+struct Batch_ {
+  BatchJob *jobs;
+  int jobCount;
+  int nextJob;           // the next job a worker will claim
+  pthread_mutex_t lock;
+  pthread_cond_t jobDone;
+};
+
+typedef struct Batch_ Batch;
+
+/******************************************************************/
+
+// Collect the output of one compilation in memory
+#ifdef _WIN32
+
+static FILE* openOutput(BatchJob *job) {
+  (void) job;
+  return tmpfile();
+}
+
+static void closeOutput(FILE *f, BatchJob *job) {
+  long size = ftell(f);
+  job->output = (char*) malloc(size > 0 ? size : 1);
+  rewind(f);
+  job->outputSize = fread(job->output, 1, size, f);
+  fclose(f);
+}
+
+#else
+
+static FILE* openOutput(BatchJob *job) {
+  return open_memstream(&job->output, &job->outputSize);
+}
+
+static void closeOutput(FILE *f, BatchJob *job) {
+  (void) job;
+  fclose(f);
+}
+
+#endif
+
+static void* batchWorker(void *arg) {
+  Batch *batch = (Batch*) arg;
+  CompilerContext *context = createContext();
+  BatchJob *job;
+  FILE *output;
+  int i;
+
+  for (;;) {
+    pthread_mutex_lock(&batch->lock);
+    i = batch->nextJob ++;
+    pthread_mutex_unlock(&batch->lock);
+    if (i >= batch->jobCount)
+      break;
+
+    job = &batch->jobs[i];
+    output = openOutput(job);
+    if (output == NULL)
+      job->status = NO_OUTPUT;
+    else {
+      context->output = output;
+      job->status = compile(context, job->fileName);
+      job->errorCount = getErrorCount();
+      context->output = stdout;
+      closeOutput(output, job);
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    job->done = 1;
+    pthread_cond_broadcast(&batch->jobDone);
+    pthread_mutex_unlock(&batch->lock);
+  }
+
+  freeContext(context);
+  return NULL;
+}
+
+double wallClock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int compileBatch(char **fileNames, int fileCount, int threadCount) {
+  Batch batch;
+  pthread_t threads[MAX_THREADS];
+  BatchJob *job;
+  int failed = 0, started = 0;
+  double start, elapsed;
+  int i;
+
+  if (threadCount < 1) threadCount = 1;
+  if (threadCount > MAX_THREADS) threadCount = MAX_THREADS;
+  if (threadCount > fileCount) threadCount = (fileCount > 0) ? fileCount : 1;
+
+  batch.jobs = (BatchJob*) calloc(fileCount > 0 ? fileCount : 1, sizeof(BatchJob));
+  batch.jobCount = fileCount;
+  batch.nextJob = 0;
+  pthread_mutex_init(&batch.lock, NULL);
+  pthread_cond_init(&batch.jobDone, NULL);
+  for (i = 0; i < fileCount; i ++)
+    batch.jobs[i].fileName = fileNames[i];
+
+  start = wallClock();
+  for (i = 0; i < threadCount; i ++)
+    if (pthread_create(&threads[started], NULL, batchWorker, &batch) == 0)
+      started ++;
+  // without a worker, every file is compiled here
+  if (started == 0) {
+    batchWorker(&batch);
+    threadCount = 1;
+  } else threadCount = started;
+
+  // Print the results in input order as soon as each one is ready
+  for (i = 0; i < fileCount; i ++) {
+    job = &batch.jobs[i];
+    pthread_mutex_lock(&batch.lock);
+    while (!job->done)
+      pthread_cond_wait(&batch.jobDone, &batch.lock);
+    pthread_mutex_unlock(&batch.lock);
+
+    printf("== %s\n", job->fileName);
+    if (job->status == IO_ERROR) {
+      printf("Can\'t read input file!\n");
+      failed ++;
+    } else if (job->status == NO_OUTPUT) {
+      printf("Can\'t collect the output!\n");
+      failed ++;
+    } else {
+      fwrite(job->output, 1, job->outputSize, stdout);
+      if (job->errorCount > 0)
+        failed ++;
+    }
+    free(job->output);
+  }
+
+  for (i = 0; i < started; i ++)
+    pthread_join(threads[i], NULL);
+  elapsed = wallClock() - start;
+
+  fflush(stdout);
+  fprintf(stderr, "%d files, %d failed, %d threads, %.3f s, %.0f files/sec\n",
+          fileCount, failed, threadCount, elapsed, (elapsed > 0) ? fileCount / elapsed : 0.0);
+
+  pthread_cond_destroy(&batch.jobDone);
+  pthread_mutex_destroy(&batch.lock);
+  free(batch.jobs);
+  return failed;
+}
+
+// One file name per line; blank lines are skipped
+int readManifest(FILE *f, char ***fileNames) {
+  char line[4096];
+  char **names = NULL;
+  int count = 0, capacity = 0;
+  int len;
+
+  while (fgets(line, sizeof(line), f) != NULL) {
+    len = strlen(line);
+    while ((len > 0) && ((line[len - 1] == '\n') || (line[len - 1] == '\r')))
+      line[-- len] = '\0';
+    if (len == 0)
+      continue;
+    if (count == capacity) {
+      capacity = (capacity == 0) ? 1024 : capacity * 2;
+      names = (char**) realloc(names, capacity * sizeof(char*));
+    }
+    names[count] = (char*) malloc(len + 1);
+    memcpy(names[count], line, len + 1);
+    count ++;
+  }
+  *fileNames = names;
+  return count;
+}
+
+int defaultThreadCount(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0)
+    return (int) n;
+#endif
+  return 1;
+}
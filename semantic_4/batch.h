@@ -0,0 +1,24 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdio.h>
+
+// Compiles the files on threadCount worker threads. Each file's output is
+// printed to stdout, in the order the files were given, after a "== <file>"
+// header; a summary line goes to stderr.
+// Returns the number of files that failed (unreadable or with errors).
+int compileBatch(char **fileNames, int fileCount, int threadCount);
+
+int readManifest(FILE *f, char ***fileNames);
+int defaultThreadCount(void);
+
+// Seconds of a monotonic clock
+double wallClock(void);
+
+#endif
@@ -0,0 +1,174 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reader.h"
+#include "scanner.h"
+#include "intern.h"
+#include "batch.h"
+#include "context.h"
+
+// Times the scanner alone:
+//   benchscan [-g] [-s megabytes] [-p passes] file
+// With -g, file is first filled with a synthetic KPL source of the given
+// size (16 MB by default). getToken is run over the whole file once per
+// pass and the best pass is reported.
+
+#define DEFAULT_SIZE 16
+#define DEFAULT_PASSES 5
+
+static unsigned int seed = 12345;
+
+// The same corpus on every run
+static unsigned int randomNumber(unsigned int n) {
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) % n;
+}
+
+static char *keywords[] = {
+  "PROGRAM", "CONST", "TYPE", "VAR", "INTEGER", "CHAR", "ARRAY", "OF", "FUNCTION",
+  "PROCEDURE", "BEGIN", "END", "CALL", "IF", "THEN", "ELSE", "WHILE", "DO", "FOR", "TO"
+};
+
+static char *symbols[] = {
+  ";", ":", ".", ",", ":=", "=", "!=", "<", "<=", ">", ">=",
+  "+", "-", "*", "/", "(", ")", "(.", ".)"
+};
+
+#define KEYWORD_COUNT (sizeof(keywords) / sizeof(keywords[0]))
+#define SYMBOL_COUNT (sizeof(symbols) / sizeof(symbols[0]))
+
+static void writeIdent(FILE *f) {
+  static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+  static const char others[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+  int i, length = 1 + randomNumber(MAX_IDENT_LEN);
+
+  fputc(letters[randomNumber(sizeof(letters) - 1)], f);
+  for (i = 1; i < length; i ++)
+    fputc(others[randomNumber(sizeof(others) - 1)], f);
+}
+
+static void writeComment(FILE *f) {
+  static const char text[] = "abcdefghijklmnopqrstuvwxyz0123456789 ,;:=+-/(.*";
+  int i, length = randomNumber(80);
+
+  fputs("(*", f);
+  for (i = 0; i < length; i ++)
+    fputc(text[randomNumber(sizeof(text) - 1)], f);
+  fputs("*)", f);
+}
+
+// Lines of indented tokens of every kind, with comments here and there
+static void generateCorpus(FILE *f, long size) {
+  int i, count;
+
+  while (ftell(f) < size) {
+    count = randomNumber(16);
+    for (i = 0; i < count; i ++)
+      fputc(' ', f);
+    count = 1 + randomNumber(12);
+    for (i = 0; i < count; i ++) {
+      switch (randomNumber(10)) {
+      case 0: case 1: case 2:
+        writeIdent(f);
+        break;
+      case 3:
+        fputs(keywords[randomNumber(KEYWORD_COUNT)], f);
+        break;
+      case 4:
+        fprintf(f, "%u", randomNumber(100000));
+        break;
+      case 5:
+        fprintf(f, "'%c'", 'A' + randomNumber(26));
+        break;
+      case 6:
+        writeComment(f);
+        break;
+      default:
+        fputs(symbols[randomNumber(SYMBOL_COUNT)], f);
+        break;
+      }
+      fputc(' ', f);
+    }
+    if (randomNumber(4) == 0)
+      writeComment(f);
+    fputc('\n', f);
+  }
+}
+
+// Scans the whole input; returns the number of tokens
+static long scanAll(void) {
+  Token token;
+  long count = 0;
+
+  do {
+    getToken(&token);
+    count ++;
+  } while (token.tokenType != TK_EOF);
+  return count;
+}
+
+int main(int argc, char *argv[]) {
+  CompilerContext *context;
+  char *fileName = NULL;
+  int generate = 0, passes = DEFAULT_PASSES;
+  long size = DEFAULT_SIZE, tokens = 0, bytes = 0;
+  double start, elapsed, best = 0;
+  FILE *f;
+  int i;
+
+  for (i = 1; i < argc; i ++) {
+    if (strcmp(argv[i], "-g") == 0)
+      generate = 1;
+    else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc))
+      size = atol(argv[++ i]);
+    else if ((strcmp(argv[i], "-p") == 0) && (i + 1 < argc))
+      passes = atoi(argv[++ i]);
+    else fileName = argv[i];
+  }
+  if ((fileName == NULL) || (size <= 0) || (passes <= 0)) {
+    fprintf(stderr, "Usage: benchscan [-g] [-s megabytes] [-p passes] file\n");
+    return 1;
+  }
+
+  if (generate) {
+    f = fopen(fileName, "w");
+    if (f == NULL) {
+      fprintf(stderr, "Can't write %s!\n", fileName);
+      return 1;
+    }
+    generateCorpus(f, size * 1024 * 1024);
+    fclose(f);
+  }
+
+  context = createContext();
+  useContext(context);
+  for (i = 0; i < passes; i ++) {
+    if (openInputStream(fileName) == IO_ERROR) {
+      fprintf(stderr, "Can't read input file!\n");
+      return 1;
+    }
+    bytes = context->inputSize;
+    context->diagnosticCount = 0;
+    start = wallClock();
+    tokens = scanAll();
+    elapsed = wallClock() - start;
+    if ((i == 0) || (elapsed < best))
+      best = elapsed;
+    freeInternPool();
+    closeInputStream();
+  }
+
+  printf("%s: %.1f MB, %ld tokens, %d errors\n", fileName,
+         bytes / (1024.0 * 1024.0), tokens, context->diagnosticCount);
+  if (best > 0)
+    printf("getToken %8.3f s %9.1f MB/s %9.2f Mtokens/s (best of %d)\n", best,
+           bytes / (1024.0 * 1024.0) / best, tokens / 1e6 / best, passes);
+  freeContext(context);
+  return 0;
+}
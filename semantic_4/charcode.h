@@ -26,7 +26,14 @@ typedef enum {
   CHAR_SINGLEQUOTE,
   CHAR_LPAR,
   CHAR_RPAR,
-  CHAR_UNKNOWN
+  CHAR_UNKNOWN,
+  CHAR_EOF            // the end of input, a class of its own
 } CharCode;
 
+// The table has an entry for EOF (-1) before those of the 256 characters,
+// so the index is biased by one
+extern CharCode charCodes[257];
+
+#define CHAR_CODE(c) (charCodes[(c) + 1])
+
 #endif
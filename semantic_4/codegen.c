@@ -0,0 +1,388 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "codegen.h"
+#include "error.h"
+#include "context.h"
+
+// Everything is generated into ctx->code while ctx->symtab->currentScope is
+// the scope of the subprogram being generated.
+
+CodeAddress emit(enum OpCode op, WORD p, WORD q, NodeId id) {
+  return emitCode(&ctx->code, op, p, q, ctx->positions[id].lineNo);
+}
+
+CodeAddress currentAddress(void) {
+  return ctx->code.codeSize;
+}
+
+void patchJump(CodeAddress jump) {
+  ctx->code.code[jump].q = currentAddress();
+}
+
+Scope* ownerScope(Object* owner) {
+  switch (owner->kind) {
+  case OBJ_FUNCTION:
+    return owner->funcAttrs->scope;
+  case OBJ_PROCEDURE:
+    return owner->procAttrs->scope;
+  default:
+    return owner->progAttrs->scope;
+  }
+}
+
+// Number of static links to follow from the current frame to the frame of scope
+int levelDistance(Scope* scope) {
+  return ctx->symtab->currentScope->level - scope->level;
+}
+
+// The built-in subprograms become single instructions; OP_BP for the others
+enum OpCode builtinOp(Object* obj) {
+  ObjectNode* node;
+
+  for (node = ctx->symtab->globalObjectList; node != NULL; node = node->next)
+    if (node->object == obj) {
+      if (strcmp(obj->name, "READC") == 0) return OP_RC;
+      if (strcmp(obj->name, "READI") == 0) return OP_RI;
+      if (strcmp(obj->name, "WRITEI") == 0) return OP_WRI;
+      if (strcmp(obj->name, "WRITEC") == 0) return OP_WRC;
+      if (strcmp(obj->name, "WRITELN") == 0) return OP_WLN;
+    }
+  return OP_BP;
+}
+
+// An index whose value is known to be in range needs no check
+int knownIndex(NodeId id) {
+  AstNode* index = AST_NODE(AST_NODE(id)->b);
+
+  return (index->kind == AST_NUMBER) && (index->value >= 1) && (index->value <= nodeType(AST_NODE(id)->a)->arraySize);
+}
+
+// Finds the variable and the word of its frame an lvalue made of a variable
+// and known indexes stands for
+int knownLocation(NodeId id, Object** variable, int* offset) {
+  AstNode* node = AST_NODE(id);
+
+  if (node->kind == AST_VARIABLE) {
+    if (node->object->kind != OBJ_VARIABLE)
+      return 0;
+    *variable = node->object;
+    *offset = node->object->varAttrs->localOffset;
+    return 1;
+  }
+  if ((node->kind != AST_INDEX) || !knownIndex(id) || !knownLocation(node->a, variable, offset))
+    return 0;
+  *offset += (AST_NODE(node->b)->value - 1) * sizeOfType(node->type);
+  return 1;
+}
+
+/******************************************************************/
+
+void layoutScope(Scope* scope) {
+  ObjectNode* node;
+  Object* obj;
+  int offset = RESERVED_WORDS;
+
+  // parameters come first, in the order the caller pushes them
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_PARAMETER)
+      obj->paramAttrs->localOffset = offset ++;
+  }
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_VARIABLE) {
+      obj->varAttrs->localOffset = offset;
+      offset += sizeOfType(obj->varAttrs->type);
+    }
+  }
+  scope->frameSize = offset;
+}
+
+void genSubprogram(Object* owner, Scope* scope) {
+  ObjectNode* node;
+  Object* obj;
+  CodeAddress entry;
+
+  // the entry jumps over the nested subprograms to the body, so that they can
+  // call the owner before its body has been generated
+  entry = emit(OP_J, 0, 0, scope->body);
+  if (owner->kind == OBJ_FUNCTION)
+    owner->funcAttrs->codeAddress = entry;
+  else if (owner->kind == OBJ_PROCEDURE)
+    owner->procAttrs->codeAddress = entry;
+
+  layoutScope(scope);
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION)
+      genSubprogram(obj, obj->funcAttrs->scope);
+    else if (obj->kind == OBJ_PROCEDURE)
+      genSubprogram(obj, obj->procAttrs->scope);
+  }
+
+  patchJump(entry);
+  enterBlock(scope);
+  emit(OP_INT, 0, scope->frameSize, scope->body);
+  genStatement(scope->body);
+  switch (owner->kind) {
+  case OBJ_FUNCTION:
+    emit(OP_EF, 0, 0, scope->body);
+    break;
+  case OBJ_PROCEDURE:
+    emit(OP_EP, 0, 0, scope->body);
+    break;
+  default:
+    emit(OP_HL, 0, 0, scope->body);
+    break;
+  }
+  exitBlock();
+}
+
+void genProgram(Object* program) {
+  initCodeBlock(&ctx->code);
+  genSubprogram(program, program->progAttrs->scope);
+}
+
+/******************************************************************/
+
+void genStatement(NodeId id) {
+  AstNode* node;
+  NodeId st;
+  CodeAddress start, falseJump, endJump;
+  Type* type;
+
+  if (id == 0) return;
+  node = AST_NODE(id);
+
+  switch (node->kind) {
+  case AST_ASSIGN:
+    type = nodeType(node->a);
+    genAddress(node->a);
+    if (type->typeClass == TP_ARRAY) {
+      genAddress(node->b);
+      emit(OP_CP, 0, sizeOfType(type), id);
+    } else {
+      genValue(node->b);
+      emit(OP_ST, 0, 0, id);
+    }
+    break;
+  case AST_CALL_ST:
+    genCall(id);
+    break;
+  case AST_BLOCK:
+    for (st = node->a; st != 0; st = AST_NODE(st)->next)
+      genStatement(st);
+    break;
+  case AST_IF:
+    genValue(node->a);
+    falseJump = emit(OP_FJ, 0, 0, id);
+    genStatement(node->b);
+    if (node->c != 0) {
+      endJump = emit(OP_J, 0, 0, id);
+      patchJump(falseJump);
+      genStatement(node->c);
+      patchJump(endJump);
+    } else patchJump(falseJump);
+    break;
+  case AST_WHILE:
+    start = currentAddress();
+    genValue(node->a);
+    falseJump = emit(OP_FJ, 0, 0, id);
+    genStatement(node->b);
+    emit(OP_J, 0, start, id);
+    patchJump(falseJump);
+    break;
+  case AST_FOR:
+    // the variable's address stays on the stack for the whole loop
+    genAddress(node->a);
+    emit(OP_CV, 0, 0, id);
+    genValue(node->b);
+    emit(OP_ST, 0, 0, id);
+
+    start = currentAddress();
+    emit(OP_CV, 0, 0, id);
+    emit(OP_LI, 0, 0, id);
+    genValue(node->c);
+    emit(OP_LE, 0, 0, id);
+    falseJump = emit(OP_FJ, 0, 0, id);
+
+    genStatement(node->body);
+
+    emit(OP_CV, 0, 0, id);
+    emit(OP_CV, 0, 0, id);
+    emit(OP_LI, 0, 0, id);
+    emit(OP_LC, 0, 1, id);
+    emit(OP_AD, 0, 0, id);
+    emit(OP_ST, 0, 0, id);
+    emit(OP_J, 0, start, id);
+    patchJump(falseJump);
+    emit(OP_DCT, 0, 1, id);
+    break;
+  default:
+    break;
+  }
+}
+
+void genValue(NodeId id) {
+  AstNode* node = AST_NODE(id);
+  Object* obj;
+  int offset;
+
+  switch (node->kind) {
+  case AST_NUMBER:
+  case AST_CHAR:
+    emit(OP_LC, 0, node->value, id);
+    break;
+  case AST_VARIABLE:
+    obj = node->object;
+    if (obj->kind == OBJ_VARIABLE) {
+      if (obj->varAttrs->type->typeClass == TP_ARRAY)
+        genAddress(id);
+      else
+        emit(OP_LV, levelDistance(obj->varAttrs->scope), obj->varAttrs->localOffset, id);
+    } else if (obj->kind == OBJ_PARAMETER) {
+      emit(OP_LV, levelDistance(ownerScope(obj->paramAttrs->function)), obj->paramAttrs->localOffset, id);
+      if (obj->paramAttrs->kind == PARAM_REFERENCE)
+        emit(OP_LI, 0, 0, id);
+    } else genAddress(id);
+    break;
+  case AST_INDEX:
+    if ((node->type->typeClass != TP_ARRAY) && knownLocation(id, &obj, &offset)) {
+      emit(OP_LV, levelDistance(obj->varAttrs->scope), offset, id);
+      break;
+    }
+    genAddress(id);
+    if (node->type->typeClass != TP_ARRAY)
+      emit(OP_LI, 0, 0, id);
+    break;
+  case AST_CALL:
+    genCall(id);
+    break;
+  case AST_NEGATE:
+    genValue(node->a);
+    emit(OP_NEG, 0, 0, id);
+    break;
+  case AST_BINARY:
+  case AST_CONDITION:
+    genValue(node->a);
+    genValue(node->b);
+    switch (node->op) {
+    case SB_PLUS: emit(OP_AD, 0, 0, id); break;
+    case SB_MINUS: emit(OP_SB, 0, 0, id); break;
+    case SB_TIMES: emit(OP_ML, 0, 0, id); break;
+    case SB_SLASH: emit(OP_DV, 0, 0, id); break;
+    case SB_EQ: emit(OP_EQ, 0, 0, id); break;
+    case SB_NEQ: emit(OP_NE, 0, 0, id); break;
+    case SB_LT: emit(OP_LT, 0, 0, id); break;
+    case SB_LE: emit(OP_LE, 0, 0, id); break;
+    case SB_GT: emit(OP_GT, 0, 0, id); break;
+    case SB_GE: emit(OP_GE, 0, 0, id); break;
+    default: break;
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void genAddress(NodeId id) {
+  AstNode* node = AST_NODE(id);
+  Object* obj;
+  Type* arrayType;
+  int elementSize, offset;
+
+  switch (node->kind) {
+  case AST_VARIABLE:
+    obj = node->object;
+    switch (obj->kind) {
+    case OBJ_VARIABLE:
+      emit(OP_LA, levelDistance(obj->varAttrs->scope), obj->varAttrs->localOffset, id);
+      break;
+    case OBJ_PARAMETER:
+      if (obj->paramAttrs->kind == PARAM_REFERENCE)
+        emit(OP_LV, levelDistance(ownerScope(obj->paramAttrs->function)), obj->paramAttrs->localOffset, id);
+      else
+        emit(OP_LA, levelDistance(ownerScope(obj->paramAttrs->function)), obj->paramAttrs->localOffset, id);
+      break;
+    case OBJ_FUNCTION:
+      // the return value, in the function's own frame
+      emit(OP_LA, levelDistance(obj->funcAttrs->scope), RETURN_VALUE_OFFSET, id);
+      break;
+    default:
+      break;
+    }
+    break;
+  case AST_INDEX:
+    // indexes run from 1 to the array size
+    arrayType = nodeType(node->a);
+    elementSize = sizeOfType(node->type);
+    if (knownLocation(id, &obj, &offset)) {
+      emit(OP_LA, levelDistance(obj->varAttrs->scope), offset, id);
+      break;
+    }
+    genAddress(node->a);
+    if (knownIndex(id)) {
+      offset = (AST_NODE(node->b)->value - 1) * elementSize;
+      if (offset != 0) {
+        emit(OP_LC, 0, offset, id);
+        emit(OP_AD, 0, 0, id);
+      }
+      break;
+    }
+    genValue(node->b);
+    if (!(node->flags & NODE_IN_RANGE))
+      emit(OP_CHK, 0, arrayType->arraySize, id);
+    emit(OP_LC, 0, 1, id);
+    emit(OP_SB, 0, 0, id);
+    if (elementSize != 1) {
+      emit(OP_LC, 0, elementSize, id);
+      emit(OP_ML, 0, 0, id);
+    }
+    emit(OP_AD, 0, 0, id);
+    break;
+  default:
+    reportError(ERR_INVALID_LVALUE, ctx->positions[id].lineNo, ctx->positions[id].colNo);
+    break;
+  }
+}
+
+void genCall(NodeId id) {
+  Object* obj = AST_NODE(id)->object;
+  enum OpCode op = builtinOp(obj);
+  ObjectNode* param;
+  Scope* scope;
+  NodeId arg;
+  int argCount = 0;
+
+  if (op != OP_BP) {
+    for (arg = AST_NODE(id)->a; arg != 0; arg = AST_NODE(arg)->next)
+      genValue(arg);
+    emit(op, 0, 0, id);
+    return;
+  }
+
+  if (obj->kind == OBJ_FUNCTION) {
+    param = obj->funcAttrs->paramList;
+    scope = obj->funcAttrs->scope;
+  } else {
+    param = obj->procAttrs->paramList;
+    scope = obj->procAttrs->scope;
+  }
+
+  emit(OP_INT, 0, RESERVED_WORDS, id);
+  for (arg = AST_NODE(id)->a; arg != 0; arg = AST_NODE(arg)->next) {
+    if (param->object->paramAttrs->kind == PARAM_REFERENCE)
+      genAddress(arg);
+    else genValue(arg);
+    param = param->next;
+    argCount ++;
+  }
+  emit(OP_DCT, 0, RESERVED_WORDS + argCount, id);
+  emit(OP_CALL, levelDistance(scope->outer), (obj->kind == OBJ_FUNCTION) ? obj->funcAttrs->codeAddress : obj->procAttrs->codeAddress, id);
+}
@@ -0,0 +1,29 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CODEGEN_H__
+#define __CODEGEN_H__
+
+#include "instructions.h"
+#include "symtab.h"
+
+// Translates the checked program into the context's code block
+void genProgram(Object* program);
+
+Scope* ownerScope(Object* owner);
+int levelDistance(Scope* scope);
+enum OpCode builtinOp(Object* obj);
+int knownIndex(NodeId id);
+int knownLocation(NodeId id, Object** variable, int* offset);
+
+void layoutScope(Scope* scope);
+void genSubprogram(Object* owner, Scope* scope);
+void genStatement(NodeId id);
+void genValue(NodeId id);
+void genAddress(NodeId id);
+void genCall(NodeId id);
+
+#endif
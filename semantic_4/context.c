@@ -0,0 +1,32 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "context.h"
+
+THREAD_LOCAL CompilerContext *ctx;
+
+CompilerContext* createContext(void) {
+  CompilerContext *context = (CompilerContext*) calloc(1, sizeof(CompilerContext));
+  context->output = stdout;
+  return context;
+}
+
+void useContext(CompilerContext *context) {
+  ctx = context;
+}
+
+void freeContext(CompilerContext *context) {
+  if (ctx == context)
+    ctx = NULL;
+  arenaFree(&context->symtabArena);
+  free(context->nodes);
+  free(context->positions);
+  freeCodeBlock(&context->code);
+  freeX86Code(&context->native);
+  free(context->diagnostics);
+  free(context);
+}
@@ -0,0 +1,108 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __CONTEXT_H__
+#define __CONTEXT_H__
+
+#include <stdio.h>
+#include <setjmp.h>
+#include "token.h"
+#include "error.h"
+#include "symtab.h"
+#include "arena.h"
+#include "instructions.h"
+#include "x86.h"
+#include "regalloc.h"
+#include "prescan.h"
+
+#define TOKEN_RING_SIZE 8      // must be a power of 2
+#define TOKEN_RING_MASK (TOKEN_RING_SIZE - 1)
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// Everything one compilation works on. Contexts are independent, so
+// several compilations can run at once, one per thread.
+struct CompilerContext_ {
+  // reader
+  char *inputBuffer;
+  char *inputEnd;
+  char *inputPtr;
+  long inputSize;
+  int currentChar;
+  // line index: lineMarks[k] is the offset of the '\n' that starts line k+1
+  // (lineMarks[0] = -1), built lazily as far as a position has been asked for
+  long *lineMarks;
+  int lineCount;
+  int lineCapacity;
+  char *indexedPtr;
+
+  // parser
+  Token tokenRing[TOKEN_RING_SIZE];
+  int ringHead;
+  int ringCount;
+  Token *currentToken;
+  Token *lookAhead;
+  TokenStream tokenStream;
+  int scanThreads;        // more than 1 to scan the whole input first, on that many threads
+
+  // abstract syntax tree
+  AstNode *nodes;
+  AstPosition *positions;
+  int nodeCount;
+  int nodeCapacity;
+
+  // symbol table
+  Arena symtabArena;      // every symbol table structure, for one compilation
+  SymTab *symtab;
+  Type *intType;
+  Type *charType;
+  Type **arrayTypes;
+  int arrayTypesSize;
+  int arrayTypesCount;
+
+  // interned identifiers
+  char **internTable;     // open addressing, kept at most half full
+  int internSize;
+  int internCount;
+  struct StringBlock_ *stringBlocks;   // the characters of the interned strings
+
+  // diagnostics
+  Diagnostic *diagnostics;
+  int diagnosticCount;
+  int diagnosticCapacity;
+  jmp_buf *panicHandler;
+
+  // generated code
+  CodeBlock code;
+  X86Code native;
+  RegisterAllocation registers;   // of the subprogram being translated
+
+  // where the symbol table dump and the diagnostics are written
+  FILE *output;
+  int options;
+};
+
+typedef struct CompilerContext_ CompilerContext;
+
+// options
+#define OPT_DUMP_AST 0x01      // print the statements along with the symbol table
+#define OPT_LIST_CODE 0x02     // print the generated code instead of the symbol table
+#define OPT_RUN 0x04           // generate code to be run; print nothing but errors
+#define OPT_ASM 0x08           // print x86-64 assembly instead of the symbol table
+#define OPT_JIT 0x10           // also assemble x86-64 machine code to be run
+
+// The context the calling thread is compiling with
+extern THREAD_LOCAL CompilerContext *ctx;
+
+CompilerContext* createContext(void);
+void useContext(CompilerContext *context);
+void freeContext(CompilerContext *context);
+
+#endif
@@ -6,24 +6,25 @@
 
 #include <stdio.h>
 #include "debug.h"
+#include "context.h"
 
 void pad(int n) {
   int i;
-  for (i = 0; i < n ; i++) printf(" ");
+  for (i = 0; i < n ; i++) fprintf(ctx->output, " ");
 }
 
 void printType(Type* type) {
   switch (type->typeClass) {
   case TP_INT:
-    printf("Int");
+    fprintf(ctx->output, "Int");
     break;
   case TP_CHAR:
-    printf("Char");
+    fprintf(ctx->output, "Char");
     break;
   case TP_ARRAY:
-    printf("Arr(%d,",type->arraySize);
+    fprintf(ctx->output, "Arr(%d,",type->arraySize);
     printType(type->elementType);
-    printf(")");
+    fprintf(ctx->output, ")");
     break;
   }
 }
@@ -31,10 +32,10 @@ void printType(Type* type) {
 void printConstantValue(ConstantValue* value) {
   switch (value->type) {
   case TP_INT:
-    printf("%d",value->intValue);
+    fprintf(ctx->output, "%d",value->intValue);
     break;
   case TP_CHAR:
-    printf("\'%c\'",value->charValue);
+    fprintf(ctx->output, "\'%c\'",value->charValue);
     break;
   default:
     break;
@@ -45,43 +46,46 @@ void printObject(Object* obj, int indent) {
   switch (obj->kind) {
   case OBJ_CONSTANT:
     pad(indent);
-    printf("Const %s = ", obj->name);
+    fprintf(ctx->output, "Const %s = ", obj->name);
     printConstantValue(obj->constAttrs->value);
     break;
   case OBJ_TYPE:
     pad(indent);
-    printf("Type %s = ", obj->name);
+    fprintf(ctx->output, "Type %s = ", obj->name);
     printType(obj->typeAttrs->actualType);
     break;
   case OBJ_VARIABLE:
     pad(indent);
-    printf("Var %s : ", obj->name);
+    fprintf(ctx->output, "Var %s : ", obj->name);
     printType(obj->varAttrs->type);
     break;
   case OBJ_PARAMETER:
     pad(indent);
     if (obj->paramAttrs->kind == PARAM_VALUE) 
-      printf("Param %s : ", obj->name);
+      fprintf(ctx->output, "Param %s : ", obj->name);
     else
-      printf("Param VAR %s : ", obj->name);
+      fprintf(ctx->output, "Param VAR %s : ", obj->name);
     printType(obj->paramAttrs->type);
     break;
   case OBJ_FUNCTION:
     pad(indent);
-    printf("Function %s : ",obj->name);
+    fprintf(ctx->output, "Function %s : ",obj->name);
     printType(obj->funcAttrs->returnType);
-    printf("\n");
+    fprintf(ctx->output, "\n");
     printScope(obj->funcAttrs->scope, indent + 4);
+    printBody(obj->funcAttrs->scope, indent + 4);
     break;
   case OBJ_PROCEDURE:
     pad(indent);
-    printf("Procedure %s\n",obj->name);
+    fprintf(ctx->output, "Procedure %s\n",obj->name);
     printScope(obj->procAttrs->scope, indent + 4);
+    printBody(obj->procAttrs->scope, indent + 4);
     break;
   case OBJ_PROGRAM:
     pad(indent);
-    printf("Program %s\n",obj->name);
+    fprintf(ctx->output, "Program %s\n",obj->name);
     printScope(obj->progAttrs->scope, indent + 4);
+    printBody(obj->progAttrs->scope, indent + 4);
     break;
   }
 }
@@ -90,7 +94,7 @@ void printObjectList(ObjectNode* objList, int indent) {
   ObjectNode *node = objList;
   while (node != NULL) {
     printObject(node->object, indent);
-    printf("\n");
+    fprintf(ctx->output, "\n");
     node = node->next;
   }
 }
@@ -99,3 +103,86 @@ void printScope(Scope* scope, int indent) {
   printObjectList(scope->objList, indent);
 }
 
+void printNode(NodeId id, int indent) {
+  AstNode* node = AST_NODE(id);
+  NodeId arg;
+
+  pad(indent);
+  switch (node->kind) {
+  case AST_ASSIGN:
+    fprintf(ctx->output, "Assign\n");
+    printNode(node->a, indent + 4);
+    printNode(node->b, indent + 4);
+    break;
+  case AST_CALL_ST:
+    fprintf(ctx->output, "Call %s\n", node->object->name);
+    for (arg = node->a; arg != 0; arg = AST_NODE(arg)->next)
+      printNode(arg, indent + 4);
+    break;
+  case AST_BLOCK:
+    fprintf(ctx->output, "Begin\n");
+    printStatements(node->a, indent + 4);
+    break;
+  case AST_IF:
+    fprintf(ctx->output, "If\n");
+    printNode(node->a, indent + 4);
+    printStatements(node->b, indent + 4);
+    if (node->c != 0) {
+      pad(indent);
+      fprintf(ctx->output, "Else\n");
+      printStatements(node->c, indent + 4);
+    }
+    break;
+  case AST_WHILE:
+    fprintf(ctx->output, "While\n");
+    printNode(node->a, indent + 4);
+    printStatements(node->b, indent + 4);
+    break;
+  case AST_FOR:
+    fprintf(ctx->output, "For\n");
+    printNode(node->a, indent + 4);
+    printNode(node->b, indent + 4);
+    printNode(node->c, indent + 4);
+    printStatements(node->body, indent + 4);
+    break;
+  case AST_NUMBER:
+    fprintf(ctx->output, "%d\n", node->value);
+    break;
+  case AST_CHAR:
+    fprintf(ctx->output, "\'%c\'\n", node->value);
+    break;
+  case AST_VARIABLE:
+    fprintf(ctx->output, "%s\n", node->object->name);
+    break;
+  case AST_INDEX:
+    fprintf(ctx->output, "Index\n");
+    printNode(node->a, indent + 4);
+    printNode(node->b, indent + 4);
+    break;
+  case AST_CALL:
+    fprintf(ctx->output, "%s()\n", node->object->name);
+    for (arg = node->a; arg != 0; arg = AST_NODE(arg)->next)
+      printNode(arg, indent + 4);
+    break;
+  case AST_NEGATE:
+    fprintf(ctx->output, "Neg\n");
+    printNode(node->a, indent + 4);
+    break;
+  case AST_BINARY:
+  case AST_CONDITION:
+    fprintf(ctx->output, "%s\n", tokenToString(node->op));
+    printNode(node->a, indent + 4);
+    printNode(node->b, indent + 4);
+    break;
+  }
+}
+
+void printStatements(NodeId id, int indent) {
+  for (; id != 0; id = AST_NODE(id)->next)
+    printNode(id, indent);
+}
+
+void printBody(Scope* scope, int indent) {
+  if ((ctx->options & OPT_DUMP_AST) && (scope->body != 0))
+    printNode(scope->body, indent);
+}
@@ -14,5 +14,8 @@ void printConstantValue(ConstantValue* value);
 void printObject(Object* obj, int indent);
 void printObjectList(ObjectNode* objList, int indent);
 void printScope(Scope* scope, int indent);
+void printNode(NodeId id, int indent);
+void printStatements(NodeId id, int indent);
+void printBody(Scope* scope, int indent);
 
 #endif
@@ -7,60 +7,121 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "error.h"
+#include "context.h"
 
-#define NUM_OF_ERRORS 29
-
-struct ErrorMessage {
-  ErrorCode errorCode;
-  char *message;
+// Messages are indexed by error code
+char *errorMessages[] = {
+  [ERR_END_OF_COMMENT] = "End of comment expected.",
+  [ERR_IDENT_TOO_LONG] = "Identifier too long.",
+  [ERR_NUMBER_TOO_LARGE] = "Number too large.",
+  [ERR_INVALID_CONSTANT_CHAR] = "Invalid char constant.",
+  [ERR_INVALID_SYMBOL] = "Invalid symbol.",
+  [ERR_INVALID_IDENT] = "An identifier expected.",
+  [ERR_INVALID_CONSTANT] = "A constant expected.",
+  [ERR_INVALID_TYPE] = "A type expected.",
+  [ERR_INVALID_BASICTYPE] = "A basic type expected.",
+  [ERR_INVALID_VARIABLE] = "A variable expected.",
+  [ERR_INVALID_FUNCTION] = "A function identifier expected.",
+  [ERR_INVALID_PROCEDURE] = "A procedure identifier expected.",
+  [ERR_INVALID_PARAMETER] = "A parameter expected.",
+  [ERR_INVALID_STATEMENT] = "Invalid statement.",
+  [ERR_INVALID_COMPARATOR] = "A comparator expected.",
+  [ERR_INVALID_EXPRESSION] = "Invalid expression.",
+  [ERR_INVALID_TERM] = "Invalid term.",
+  [ERR_INVALID_FACTOR] = "Invalid factor.",
+  [ERR_INVALID_LVALUE] = "Invalid lvalue in assignment.",
+  [ERR_INVALID_ARGUMENTS] = "Wrong arguments.",
+  [ERR_UNDECLARED_IDENT] = "Undeclared identifier.",
+  [ERR_UNDECLARED_CONSTANT] = "Undeclared constant.",
+  [ERR_UNDECLARED_INT_CONSTANT] = "Undeclared integer constant.",
+  [ERR_UNDECLARED_TYPE] = "Undeclared type.",
+  [ERR_UNDECLARED_VARIABLE] = "Undeclared variable.",
+  [ERR_UNDECLARED_FUNCTION] = "Undeclared function.",
+  [ERR_UNDECLARED_PROCEDURE] = "Undeclared procedure.",
+  [ERR_DUPLICATE_IDENT] = "Duplicate identifier.",
+  [ERR_TYPE_INCONSISTENCY] = "Type inconsistency",
+  [ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY] = "The number of arguments and the number of parameters are inconsistent.",
+  [ERR_INDEX_OUT_OF_RANGE] = "Index out of range."
 };
 
-struct ErrorMessage errors[29] = {
-  {ERR_END_OF_COMMENT, "End of comment expected."},
-  {ERR_IDENT_TOO_LONG, "Identifier too long."},
-  {ERR_INVALID_CONSTANT_CHAR, "Invalid char constant."},
-  {ERR_INVALID_SYMBOL, "Invalid symbol."},
-  {ERR_INVALID_IDENT, "An identifier expected."},
-  {ERR_INVALID_CONSTANT, "A constant expected."},
-  {ERR_INVALID_TYPE, "A type expected."},
-  {ERR_INVALID_BASICTYPE, "A basic type expected."},
-  {ERR_INVALID_VARIABLE, "A variable expected."},
-  {ERR_INVALID_FUNCTION, "A function identifier expected."},
-  {ERR_INVALID_PROCEDURE, "A procedure identifier expected."},
-  {ERR_INVALID_PARAMETER, "A parameter expected."},
-  {ERR_INVALID_STATEMENT, "Invalid statement."},
-  {ERR_INVALID_COMPARATOR, "A comparator expected."},
-  {ERR_INVALID_EXPRESSION, "Invalid expression."},
-  {ERR_INVALID_TERM, "Invalid term."},
-  {ERR_INVALID_FACTOR, "Invalid factor."},
-  {ERR_INVALID_LVALUE, "Invalid lvalue in assignment."},
-  {ERR_INVALID_ARGUMENTS, "Wrong arguments."},
-  {ERR_UNDECLARED_IDENT, "Undeclared identifier."},
-  {ERR_UNDECLARED_CONSTANT, "Undeclared constant."},
-  {ERR_UNDECLARED_INT_CONSTANT, "Undeclared integer constant."},
-  {ERR_UNDECLARED_TYPE, "Undeclared type."},
-  {ERR_UNDECLARED_VARIABLE, "Undeclared variable."},
-  {ERR_UNDECLARED_FUNCTION, "Undeclared function."},
-  {ERR_UNDECLARED_PROCEDURE, "Undeclared procedure."},
-  {ERR_DUPLICATE_IDENT, "Duplicate identifier."},
-  {ERR_TYPE_INCONSISTENCY, "Type inconsistency"},
-  {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."}
-};
+// Fails to compile unless the table reaches the last error code; a code
+// added in the middle without a message gets the fallback below
+typedef char errorMessagesCheck[(sizeof(errorMessages) / sizeof(errorMessages[0]) == NUM_OF_ERRORS) ? 1 : -1];
+
+
+char *errorMessage(ErrorCode err) {
+  if (((unsigned) err >= NUM_OF_ERRORS) || (errorMessages[err] == NULL))
+    return "Unknown error.";
+  return errorMessages[err];
+}
+
+void addDiagnostic(ErrorCode err, TokenType missing, int lineNo, int colNo) {
+  Diagnostic *last;
+
+  // an error at the same place as the previous one is a cascade of it
+  if (ctx->diagnosticCount > 0) {
+    last = &ctx->diagnostics[ctx->diagnosticCount - 1];
+    if ((last->lineNo == lineNo) && (last->colNo == colNo))
+      return;
+  }
+
+  if (ctx->diagnosticCount == ctx->diagnosticCapacity) {
+    ctx->diagnosticCapacity = (ctx->diagnosticCapacity == 0) ? 16 : ctx->diagnosticCapacity * 2;
+    ctx->diagnostics = (Diagnostic*) realloc(ctx->diagnostics, ctx->diagnosticCapacity * sizeof(Diagnostic));
+  }
+  ctx->diagnostics[ctx->diagnosticCount].errorCode = err;
+  ctx->diagnostics[ctx->diagnosticCount].missingToken = missing;
+  ctx->diagnostics[ctx->diagnosticCount].lineNo = lineNo;
+  ctx->diagnostics[ctx->diagnosticCount].colNo = colNo;
+  ctx->diagnosticCount ++;
+}
+
+void panic(void) {
+  if (ctx->panicHandler != NULL)
+    longjmp(*ctx->panicHandler, 1);
+  // nobody can recover: give up with what has been collected
+  printErrors();
+  exit(1);
+}
+
+void reportError(ErrorCode err, int lineNo, int colNo) {
+  addDiagnostic(err, TK_NONE, lineNo, colNo);
+}
 
 void error(ErrorCode err, int lineNo, int colNo) {
-  int i;
-  for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
-    if (errors[i].errorCode == err) {
-      printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
-      exit(0);
-    }
+  addDiagnostic(err, TK_NONE, lineNo, colNo);
+  panic();
 }
 
 void missingToken(TokenType tokenType, int lineNo, int colNo) {
-  printf("%d-%d:Missing %s\n", lineNo, colNo, tokenToString(tokenType));
-  exit(0);
+  addDiagnostic(0, tokenType, lineNo, colNo);
+  panic();
 }
 
 void assert(char *msg) {
   printf("%s\n", msg);
 }
+
+int getErrorCount(void) {
+  return ctx->diagnosticCount;
+}
+
+void printErrors(void) {
+  int i;
+  Diagnostic *d;
+
+  for (i = 0; i < ctx->diagnosticCount; i ++) {
+    d = &ctx->diagnostics[i];
+    if (d->missingToken != TK_NONE)
+      fprintf(ctx->output, "%d-%d:Missing %s\n", d->lineNo, d->colNo, tokenToString(d->missingToken));
+    else
+      fprintf(ctx->output, "%d-%d:%s\n", d->lineNo, d->colNo, errorMessage(d->errorCode));
+  }
+}
+
+void clearErrors(void) {
+  free(ctx->diagnostics);
+  ctx->diagnostics = NULL;
+  ctx->diagnosticCount = 0;
+  ctx->diagnosticCapacity = 0;
+}
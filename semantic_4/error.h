@@ -11,6 +11,7 @@
 typedef enum {
   ERR_END_OF_COMMENT,
   ERR_IDENT_TOO_LONG,
+  ERR_NUMBER_TOO_LARGE,
   ERR_INVALID_CONSTANT_CHAR,
   ERR_INVALID_SYMBOL,
   ERR_INVALID_IDENT,
@@ -37,11 +38,31 @@ typedef enum {
   ERR_UNDECLARED_PROCEDURE,
   ERR_DUPLICATE_IDENT,
   ERR_TYPE_INCONSISTENCY,
-  ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY
+  ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY,
+  ERR_INDEX_OUT_OF_RANGE,
+  NUM_OF_ERRORS      // number of error codes, keep last
 } ErrorCode;
 
+struct Diagnostic_ {
+  ErrorCode errorCode;
+  TokenType missingToken;   // TK_NONE unless the diagnostic is a missing token
+  int lineNo, colNo;
+};
+
+typedef struct Diagnostic_ Diagnostic;
+
+// Errors are collected rather than fatal. error() and missingToken() record
+// the diagnostic and then longjmp to the context's panicHandler, the recovery
+// point the parser has set up; reportError() only records it.
+
+void reportError(ErrorCode err, int lineNo, int colNo);
 void error(ErrorCode err, int lineNo, int colNo);
 void missingToken(TokenType tokenType, int lineNo, int colNo);
 void assert(char *msg);
 
+char *errorMessage(ErrorCode err);
+int getErrorCount(void);
+void printErrors(void);
+void clearErrors(void);
+
 #endif
@@ -0,0 +1,211 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "exec.h"
+
+// Super-instructions replacing the most frequent sequences of the generated
+// code. They continue the numbering of enum OpCode, whose instructions are
+// kept as they are.
+enum ExecOp {
+  X_LA0 = NUM_OF_OPCODES, // LA 0,q
+  X_LV0,                  // LV 0,q
+  X_LV0_LV0,              // LV 0,p; LV 0,q
+  X_LV0_LC,               // LV 0,p; LC q
+  X_LV0_ADC,              // LV 0,p; LC q; AD       (SB with -q)
+  X_LV0_AD,               // LV 0,q; AD
+  X_ADC,                  // LC q; AD               (SB with -q)
+  X_CV_LI,                // CV; LI
+  X_INC,                  // CV; CV; LI; LC 1; AD; ST   the step of a FOR loop
+  X_EQ_FJ,                // EQ; FJ q
+  X_NE_FJ,                // NE; FJ q
+  X_GT_FJ,                // GT; FJ q
+  X_LT_FJ,                // LT; FJ q
+  X_GE_FJ,                // GE; FJ q
+  X_LE_FJ,                // LE; FJ q
+  NUM_OF_EXEC_OPS
+};
+
+// A sequence of count instructions from i can be fused unless one of them,
+// but the first, is the target of a jump
+static int fusible(CodeBlock* codeBlock, char* targets, int i, int count) {
+  int k;
+
+  if (i + count > codeBlock->codeSize)
+    return 0;
+  for (k = 1; k < count; k ++)
+    if (targets[i + k])
+      return 0;
+  return 1;
+}
+
+static int isJump(int op) {
+  return (op == OP_J) || (op == OP_FJ) || (op == OP_CALL) || ((op >= X_EQ_FJ) && (op <= X_LE_FJ));
+}
+
+void lowerCode(CodeBlock* codeBlock, ExecCode* program) {
+  Instruction* code = codeBlock->code;
+  int n = codeBlock->codeSize;
+  char* targets = (char*) calloc(n + 1, sizeof(char));
+  int* newAddress = (int*) malloc((n + 1) * sizeof(int));
+  ExecInstruction* x;
+  int i, next;
+
+  for (i = 0; i < n; i ++) {
+    if (isJump(code[i].op))
+      targets[code[i].q] = 1;
+    if (code[i].op == OP_CALL)
+      targets[i + 1] = 1;       // the return address
+  }
+
+  program->code = (ExecInstruction*) malloc((n + 1) * sizeof(ExecInstruction));
+  program->lineNos = (int*) malloc((n + 1) * sizeof(int));
+  program->codeSize = 0;
+
+  for (i = 0; i < n; i = next) {
+    x = &program->code[program->codeSize];
+    x->handler = NULL;
+    x->op = code[i].op;
+    x->p = code[i].p;
+    x->q = code[i].q;
+    next = i + 1;
+
+    switch (code[i].op) {
+    case OP_LA:
+      if (code[i].p == 0)
+        x->op = X_LA0;
+      break;
+    case OP_LV:
+      if (code[i].p != 0)
+        break;
+      x->op = X_LV0;
+      if (fusible(codeBlock, targets, i, 3) && (code[i + 1].op == OP_LC)
+          && ((code[i + 2].op == OP_AD) || (code[i + 2].op == OP_SB))) {
+        x->op = X_LV0_ADC;
+        x->p = code[i].q;
+        x->q = (code[i + 2].op == OP_AD) ? code[i + 1].q : (WORD) (0u - (unsigned int) code[i + 1].q);
+        next = i + 3;
+      } else if (fusible(codeBlock, targets, i, 2)) {
+        if (code[i + 1].op == OP_LC) {
+          x->op = X_LV0_LC;
+          x->p = code[i].q;
+          x->q = code[i + 1].q;
+          next = i + 2;
+        } else if ((code[i + 1].op == OP_LV) && (code[i + 1].p == 0)) {
+          x->op = X_LV0_LV0;
+          x->p = code[i].q;
+          x->q = code[i + 1].q;
+          next = i + 2;
+        } else if (code[i + 1].op == OP_AD) {
+          x->op = X_LV0_AD;
+          next = i + 2;
+        }
+      }
+      break;
+    case OP_LC:
+      if (fusible(codeBlock, targets, i, 2)
+          && ((code[i + 1].op == OP_AD) || (code[i + 1].op == OP_SB))) {
+        x->op = X_ADC;
+        if (code[i + 1].op == OP_SB)
+          x->q = (WORD) (0u - (unsigned int) code[i].q);
+        next = i + 2;
+      }
+      break;
+    case OP_CV:
+      if (fusible(codeBlock, targets, i, 6) && (code[i + 1].op == OP_CV) && (code[i + 2].op == OP_LI)
+          && (code[i + 3].op == OP_LC) && (code[i + 3].q == 1) && (code[i + 4].op == OP_AD)
+          && (code[i + 5].op == OP_ST)) {
+        x->op = X_INC;
+        next = i + 6;
+      } else if (fusible(codeBlock, targets, i, 2) && (code[i + 1].op == OP_LI)) {
+        x->op = X_CV_LI;
+        next = i + 2;
+      }
+      break;
+    case OP_EQ:
+    case OP_NE:
+    case OP_GT:
+    case OP_LT:
+    case OP_GE:
+    case OP_LE:
+      if (fusible(codeBlock, targets, i, 2) && (code[i + 1].op == OP_FJ)) {
+        x->op = X_EQ_FJ + (code[i].op - OP_EQ);
+        x->q = code[i + 1].q;
+        next = i + 2;
+      }
+      break;
+    default:
+      break;
+    }
+
+    for (; i < next; i ++)
+      newAddress[i] = program->codeSize;
+    program->lineNos[program->codeSize] = codeBlock->lineNos[next - 1];
+    program->codeSize ++;
+  }
+  newAddress[n] = program->codeSize;
+
+  for (i = 0; i < program->codeSize; i ++)
+    if (isJump(program->code[i].op))
+      program->code[i].q = newAddress[program->code[i].q];
+
+  free(newAddress);
+  free(targets);
+}
+
+void freeExecCode(ExecCode* program) {
+  free(program->code);
+  free(program->lineNos);
+  program->code = NULL;
+  program->lineNos = NULL;
+  program->codeSize = 0;
+}
+
+/******************************************************************/
+
+// Both engines are instantiated from the same handlers in execloop.h; they
+// only differ in the way the next instruction is dispatched.
+
+#if HAVE_THREADED_ENGINE
+
+#define THREADED_ENGINE
+#define ENGINE_FUNCTION runThreaded
+#define CASE(op) L_##op:
+#define DISPATCH() goto *ip->handler
+#include "execloop.h"
+#undef THREADED_ENGINE
+#undef ENGINE_FUNCTION
+#undef CASE
+#undef DISPATCH
+
+#endif
+
+#define ENGINE_FUNCTION runSwitched
+#define CASE(op) case op:
+#define DISPATCH() goto dispatch
+#include "execloop.h"
+#undef ENGINE_FUNCTION
+#undef CASE
+#undef DISPATCH
+
+VMResult execCode(CodeBlock* codeBlock, int stackSize, Engine engine) {
+  ExecCode program;
+  VMResult result;
+
+  lowerCode(codeBlock, &program);
+#if HAVE_THREADED_ENGINE
+  if (engine == ENGINE_THREADED)
+    result = runThreaded(&program, stackSize);
+  else
+#else
+  (void) engine;
+#endif
+    result = runSwitched(&program, stackSize);
+  freeExecCode(&program);
+  return result;
+}
@@ -0,0 +1,51 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __EXEC_H__
+#define __EXEC_H__
+
+#include "instructions.h"
+#include "vm.h"
+
+// The threaded engine needs the labels-as-values extension of GCC and Clang
+#if defined(__GNUC__) && !defined(NO_THREADED_ENGINE)
+#define HAVE_THREADED_ENGINE 1
+#else
+#define HAVE_THREADED_ENGINE 0
+#endif
+
+typedef enum {
+  ENGINE_SWITCH,        // one switch dispatching every instruction
+  ENGINE_THREADED       // direct threading: each handler jumps to the next one
+} Engine;
+
+// Code lowered for the engines: addresses are indexes into the lowered code,
+// handler is the label of the instruction in the threaded engine
+struct ExecInstruction_ {
+  const void* handler;
+  int op;
+  WORD p;
+  WORD q;
+};
+
+typedef struct ExecInstruction_ ExecInstruction;
+
+struct ExecCode_ {
+  ExecInstruction* code;
+  int* lineNos;
+  int codeSize;
+};
+
+typedef struct ExecCode_ ExecCode;
+
+void lowerCode(CodeBlock* codeBlock, ExecCode* program);
+void freeExecCode(ExecCode* program);
+
+// Same behaviour as runVM. ENGINE_THREADED falls back to ENGINE_SWITCH when
+// the compiler has no computed goto.
+VMResult execCode(CodeBlock* codeBlock, int stackSize, Engine engine);
+
+#endif
@@ -0,0 +1,241 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+// The body of an engine, included by exec.c once per dispatch method with
+// ENGINE_FUNCTION, CASE(op) and DISPATCH() defined. Handlers jump to the
+// instruction at ip; the static link walks are the only loops.
+
+#define NEXT() do { ip ++; DISPATCH(); } while (0)
+#define JUMP(target) do { ip = code + (target); DISPATCH(); } while (0)
+#define FAIL(r) do { result = (r); goto stop; } while (0)
+#define BASE(level) for (base = b, l = (level); l > 0; l --) base = s[base + STATIC_LINK_OFFSET]
+#define BINARY(expr) do { t --; s[t] = (expr); NEXT(); } while (0)
+#define WRAP(a, op, c) ((WORD) ((unsigned int) (a) op (unsigned int) (c)))
+#define COMPARE_JUMP(cmp) do { t -= 2; if (s[t + 1] cmp s[t + 2]) NEXT(); JUMP(ip->q); } while (0)
+
+static VMResult ENGINE_FUNCTION(ExecCode* program, int stackSize) {
+  ExecInstruction* code = program->code;
+  ExecInstruction* ip = code;
+  WORD* s = (WORD*) calloc(stackSize, sizeof(WORD));
+  Console* console = (Console*) malloc(sizeof(Console));
+  int t = -1;       // top of the stack
+  int b = 0;        // base of the current frame
+  int base, l, i;
+  VMResult result = VM_OK;
+
+#ifdef THREADED_ENGINE
+  static const void* labels[] = {
+    [OP_LA] = &&L_OP_LA, [OP_LV] = &&L_OP_LV, [OP_LC] = &&L_OP_LC, [OP_LI] = &&L_OP_LI,
+    [OP_INT] = &&L_OP_INT, [OP_DCT] = &&L_OP_DCT, [OP_J] = &&L_OP_J, [OP_FJ] = &&L_OP_FJ,
+    [OP_HL] = &&L_OP_HL, [OP_ST] = &&L_OP_ST, [OP_CALL] = &&L_OP_CALL, [OP_EP] = &&L_OP_EP,
+    [OP_EF] = &&L_OP_EF, [OP_RC] = &&L_OP_RC, [OP_RI] = &&L_OP_RI, [OP_WRC] = &&L_OP_WRC,
+    [OP_WRI] = &&L_OP_WRI, [OP_WLN] = &&L_OP_WLN, [OP_AD] = &&L_OP_AD, [OP_SB] = &&L_OP_SB,
+    [OP_ML] = &&L_OP_ML, [OP_DV] = &&L_OP_DV, [OP_NEG] = &&L_OP_NEG, [OP_CV] = &&L_OP_CV,
+    [OP_EQ] = &&L_OP_EQ, [OP_NE] = &&L_OP_NE, [OP_GT] = &&L_OP_GT, [OP_LT] = &&L_OP_LT,
+    [OP_GE] = &&L_OP_GE, [OP_LE] = &&L_OP_LE, [OP_CHK] = &&L_OP_CHK, [OP_CP] = &&L_OP_CP,
+    [OP_BP] = &&L_OP_BP,
+    [X_LA0] = &&L_X_LA0, [X_LV0] = &&L_X_LV0, [X_LV0_LV0] = &&L_X_LV0_LV0,
+    [X_LV0_LC] = &&L_X_LV0_LC, [X_LV0_ADC] = &&L_X_LV0_ADC, [X_LV0_AD] = &&L_X_LV0_AD,
+    [X_ADC] = &&L_X_ADC, [X_CV_LI] = &&L_X_CV_LI, [X_INC] = &&L_X_INC,
+    [X_EQ_FJ] = &&L_X_EQ_FJ, [X_NE_FJ] = &&L_X_NE_FJ, [X_GT_FJ] = &&L_X_GT_FJ,
+    [X_LT_FJ] = &&L_X_LT_FJ, [X_GE_FJ] = &&L_X_GE_FJ, [X_LE_FJ] = &&L_X_LE_FJ
+  };
+
+  for (i = 0; i < program->codeSize; i ++)
+    if ((code[i].op >= 0) && (code[i].op < NUM_OF_EXEC_OPS) && (labels[code[i].op] != NULL))
+      code[i].handler = labels[code[i].op];
+    else code[i].handler = &&invalid;
+#else
+  (void) i;
+#endif
+
+  console->inPos = console->inSize = 0;
+  console->outPos = 0;
+
+#ifdef THREADED_ENGINE
+  DISPATCH();
+  {
+#else
+ dispatch:
+  switch (ip->op) {
+#endif
+  CASE(OP_LA)
+    BASE(ip->p);
+    s[++ t] = base + ip->q;
+    NEXT();
+  CASE(OP_LV)
+    BASE(ip->p);
+    s[t + 1] = s[base + ip->q];
+    t ++;
+    NEXT();
+  CASE(OP_LC)
+    s[++ t] = ip->q;
+    NEXT();
+  CASE(OP_LI)
+    s[t] = s[s[t]];
+    NEXT();
+  CASE(OP_INT)
+    t += ip->q;
+    if (t + STACK_MARGIN >= stackSize)
+      FAIL(VM_STACK_OVERFLOW);
+    NEXT();
+  CASE(OP_DCT)
+    t -= ip->q;
+    NEXT();
+  CASE(OP_J)
+    JUMP(ip->q);
+  CASE(OP_FJ)
+    if (s[t --] != 0)
+      NEXT();
+    JUMP(ip->q);
+  CASE(OP_HL)
+    goto stop;
+  CASE(OP_ST)
+    s[s[t - 1]] = s[t];
+    t -= 2;
+    NEXT();
+  CASE(OP_CALL)
+    BASE(ip->p);
+    s[t + 1 + DYNAMIC_LINK_OFFSET] = b;
+    s[t + 1 + RETURN_ADDRESS_OFFSET] = (ip + 1) - code;
+    s[t + 1 + STATIC_LINK_OFFSET] = base;
+    b = t + 1;
+    JUMP(ip->q);
+  CASE(OP_EP)
+    t = b - 1;
+    b = s[t + 1 + DYNAMIC_LINK_OFFSET];
+    JUMP(s[t + 1 + RETURN_ADDRESS_OFFSET]);
+  CASE(OP_EF)
+    t = b;
+    b = s[t + DYNAMIC_LINK_OFFSET];
+    JUMP(s[t + RETURN_ADDRESS_OFFSET]);
+  CASE(OP_RC)
+    s[++ t] = readCharacter(console);
+    NEXT();
+  CASE(OP_RI)
+    s[++ t] = readInteger(console);
+    NEXT();
+  CASE(OP_WRC)
+    writeCharacter(console, s[t --]);
+    NEXT();
+  CASE(OP_WRI)
+    writeInteger(console, s[t --]);
+    NEXT();
+  CASE(OP_WLN)
+    writeCharacter(console, '\n');
+    NEXT();
+  CASE(OP_AD)
+    BINARY(WRAP(s[t], +, s[t + 1]));
+  CASE(OP_SB)
+    BINARY(WRAP(s[t], -, s[t + 1]));
+  CASE(OP_ML)
+    BINARY(WRAP(s[t], *, s[t + 1]));
+  CASE(OP_DV)
+    if (s[t] == 0)
+      FAIL(VM_DIVISION_BY_ZERO);
+    BINARY((s[t + 1] == -1) ? WRAP(0, -, s[t]) : s[t] / s[t + 1]);
+  CASE(OP_NEG)
+    s[t] = WRAP(0, -, s[t]);
+    NEXT();
+  CASE(OP_CV)
+    s[t + 1] = s[t];
+    t ++;
+    NEXT();
+  CASE(OP_EQ)
+    BINARY(s[t] == s[t + 1]);
+  CASE(OP_NE)
+    BINARY(s[t] != s[t + 1]);
+  CASE(OP_GT)
+    BINARY(s[t] > s[t + 1]);
+  CASE(OP_LT)
+    BINARY(s[t] < s[t + 1]);
+  CASE(OP_GE)
+    BINARY(s[t] >= s[t + 1]);
+  CASE(OP_LE)
+    BINARY(s[t] <= s[t + 1]);
+  CASE(OP_CHK)
+    if ((s[t] < 1) || (s[t] > ip->q))
+      FAIL(VM_INDEX_OUT_OF_RANGE);
+    NEXT();
+  CASE(OP_CP)
+    memmove(&s[s[t - 1]], &s[s[t]], ip->q * sizeof(WORD));
+    t -= 2;
+    NEXT();
+  CASE(OP_BP)
+    NEXT();
+
+  CASE(X_LA0)
+    s[++ t] = b + ip->q;
+    NEXT();
+  CASE(X_LV0)
+    s[t + 1] = s[b + ip->q];
+    t ++;
+    NEXT();
+  CASE(X_LV0_LV0)
+    s[t + 1] = s[b + ip->p];
+    s[t + 2] = s[b + ip->q];
+    t += 2;
+    NEXT();
+  CASE(X_LV0_LC)
+    s[t + 1] = s[b + ip->p];
+    s[t + 2] = ip->q;
+    t += 2;
+    NEXT();
+  CASE(X_LV0_ADC)
+    s[t + 1] = WRAP(s[b + ip->p], +, ip->q);
+    t ++;
+    NEXT();
+  CASE(X_LV0_AD)
+    s[t] = WRAP(s[t], +, s[b + ip->q]);
+    NEXT();
+  CASE(X_ADC)
+    s[t] = WRAP(s[t], +, ip->q);
+    NEXT();
+  CASE(X_CV_LI)
+    s[t + 1] = s[s[t]];
+    t ++;
+    NEXT();
+  CASE(X_INC)
+    s[s[t]] = WRAP(s[s[t]], +, 1);
+    NEXT();
+  CASE(X_EQ_FJ)
+    COMPARE_JUMP(==);
+  CASE(X_NE_FJ)
+    COMPARE_JUMP(!=);
+  CASE(X_GT_FJ)
+    COMPARE_JUMP(>);
+  CASE(X_LT_FJ)
+    COMPARE_JUMP(<);
+  CASE(X_GE_FJ)
+    COMPARE_JUMP(>=);
+  CASE(X_LE_FJ)
+    COMPARE_JUMP(<=);
+
+#ifdef THREADED_ENGINE
+  invalid:
+#else
+  default:
+#endif
+    FAIL(VM_INVALID_INSTRUCTION);
+  }
+
+ stop:
+  flushOutput(console);
+  fflush(stdout);
+  if (result != VM_OK)
+    fprintf(stderr, "%d: Runtime error: %s\n", program->lineNos[ip - code], vmErrorMessages[result]);
+  free(console);
+  free(s);
+  return result;
+}
+
+#undef NEXT
+#undef JUMP
+#undef FAIL
+#undef BASE
+#undef BINARY
+#undef WRAP
+#undef COMPARE_JUMP
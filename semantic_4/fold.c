@@ -0,0 +1,163 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "fold.h"
+#include "context.h"
+
+// Turns the node into a number
+static void setNumber(NodeId id, int value) {
+  AstNode* node = AST_NODE(id);
+
+  node->kind = AST_NUMBER;
+  node->op = 0;
+  node->a = node->b = node->c = 0;
+  node->value = value;
+}
+
+static void setEmpty(NodeId id) {
+  AstNode* node = AST_NODE(id);
+
+  node->kind = AST_BLOCK;
+  node->a = node->b = node->c = 0;
+}
+
+// Puts the statement by (maybe none) in the place of the statement id, which
+// keeps its place in the list
+static void replaceStatement(NodeId id, NodeId by) {
+  NodeId next = AST_NODE(id)->next;
+
+  if (by == 0) {
+    setEmpty(id);
+    return;
+  }
+  *AST_NODE(id) = *AST_NODE(by);
+  ctx->positions[id] = ctx->positions[by];
+  AST_NODE(id)->next = next;
+}
+
+// The value of x op y as the VM computes it; 0 when it is a runtime error
+static int evaluate(int op, int x, int y, int* value) {
+  switch (op) {
+  case SB_PLUS: *value = (int) ((unsigned int) x + (unsigned int) y); return 1;
+  case SB_MINUS: *value = (int) ((unsigned int) x - (unsigned int) y); return 1;
+  case SB_TIMES: *value = (int) ((unsigned int) x * (unsigned int) y); return 1;
+  case SB_SLASH:
+    if (y == 0)
+      return 0;
+    *value = (y == -1) ? (int) (0u - (unsigned int) x) : x / y;
+    return 1;
+  case SB_EQ: *value = (x == y); return 1;
+  case SB_NEQ: *value = (x != y); return 1;
+  case SB_LT: *value = (x < y); return 1;
+  case SB_LE: *value = (x <= y); return 1;
+  case SB_GT: *value = (x > y); return 1;
+  case SB_GE: *value = (x >= y); return 1;
+  default: return 0;
+  }
+}
+
+/******************************************************************/
+
+void foldScope(Scope* scope) {
+  ObjectNode* node;
+  Object* obj;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION)
+      foldScope(obj->funcAttrs->scope);
+    else if (obj->kind == OBJ_PROCEDURE)
+      foldScope(obj->procAttrs->scope);
+  }
+  foldStatement(scope->body);
+}
+
+void foldProgram(Object* program) {
+  foldScope(program->progAttrs->scope);
+}
+
+void foldStatement(NodeId id) {
+  AstNode* node;
+  NodeId st;
+
+  if (id == 0) return;
+  node = AST_NODE(id);
+
+  switch (node->kind) {
+  case AST_ASSIGN:
+    foldExpression(node->a);
+    foldExpression(node->b);
+    break;
+  case AST_CALL_ST:
+    foldExpression(id);
+    break;
+  case AST_BLOCK:
+    for (st = node->a; st != 0; st = AST_NODE(st)->next)
+      foldStatement(st);
+    break;
+  case AST_IF:
+    foldStatement(node->b);
+    foldStatement(node->c);
+    if (foldExpression(node->a)) {
+      if (AST_NODE(node->a)->value)
+        replaceStatement(id, node->b);
+      else replaceStatement(id, node->c);
+    }
+    break;
+  case AST_WHILE:
+    foldStatement(node->b);
+    if (foldExpression(node->a) && !AST_NODE(node->a)->value)
+      setEmpty(id);
+    break;
+  case AST_FOR:
+    foldExpression(node->b);
+    foldExpression(node->c);
+    foldStatement(node->body);
+    break;
+  default:
+    break;
+  }
+}
+
+// Returns 1 when the expression is now a number or a character
+int foldExpression(NodeId id) {
+  AstNode* node = AST_NODE(id);
+  NodeId arg;
+  int value;
+
+  switch (node->kind) {
+  case AST_NUMBER:
+  case AST_CHAR:
+    return 1;
+  case AST_INDEX:
+    foldExpression(node->a);
+    foldExpression(node->b);
+    return 0;
+  case AST_CALL:
+  case AST_CALL_ST:
+    for (arg = node->a; arg != 0; arg = AST_NODE(arg)->next)
+      foldExpression(arg);
+    return 0;
+  case AST_NEGATE:
+    if (!foldExpression(node->a))
+      return 0;
+    setNumber(id, (int) (0u - (unsigned int) AST_NODE(node->a)->value));
+    return 1;
+  case AST_BINARY:
+  case AST_CONDITION:
+    // both sides are folded before either is tested
+    value = foldExpression(node->a);
+    if (!foldExpression(node->b) || !value)
+      return 0;
+    if (!evaluate(node->op, AST_NODE(node->a)->value, AST_NODE(node->b)->value, &value))
+      return 0;
+    setNumber(id, value);
+    return 1;
+  default:
+    return 0;
+  }
+}
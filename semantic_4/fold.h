@@ -0,0 +1,22 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __FOLD_H__
+#define __FOLD_H__
+
+#include "symtab.h"
+
+// Evaluates, in place, the sub-expressions of the checked program whose
+// operands are all known (literals and constants), with the wrap-around
+// arithmetic of the VM. IF and WHILE statements whose condition is known
+// are replaced by the branch that runs.
+void foldProgram(Object* program);
+
+void foldScope(Scope* scope);
+void foldStatement(NodeId id);
+int foldExpression(NodeId id);
+
+#endif
@@ -0,0 +1,111 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "instructions.h"
+
+#define CODE_INITIAL_SIZE 1024
+
+char *opNames[] = {
+  [OP_LA] = "LA",
+  [OP_LV] = "LV",
+  [OP_LC] = "LC",
+  [OP_LI] = "LI",
+  [OP_INT] = "INT",
+  [OP_DCT] = "DCT",
+  [OP_J] = "J",
+  [OP_FJ] = "FJ",
+  [OP_HL] = "HL",
+  [OP_ST] = "ST",
+  [OP_CALL] = "CALL",
+  [OP_EP] = "EP",
+  [OP_EF] = "EF",
+  [OP_RC] = "RC",
+  [OP_RI] = "RI",
+  [OP_WRC] = "WRC",
+  [OP_WRI] = "WRI",
+  [OP_WLN] = "WLN",
+  [OP_AD] = "AD",
+  [OP_SB] = "SB",
+  [OP_ML] = "ML",
+  [OP_DV] = "DV",
+  [OP_NEG] = "NEG",
+  [OP_CV] = "CV",
+  [OP_EQ] = "EQ",
+  [OP_NE] = "NE",
+  [OP_GT] = "GT",
+  [OP_LT] = "LT",
+  [OP_GE] = "GE",
+  [OP_LE] = "LE",
+  [OP_CHK] = "CHK",
+  [OP_CP] = "CP",
+  [OP_BP] = "BP"
+};
+
+// Fails to compile unless the last opcode has its name
+typedef char opNamesCheck[(sizeof(opNames) / sizeof(opNames[0]) == NUM_OF_OPCODES) ? 1 : -1];
+
+void initCodeBlock(CodeBlock* codeBlock) {
+  codeBlock->codeSize = 0;
+}
+
+void freeCodeBlock(CodeBlock* codeBlock) {
+  free(codeBlock->code);
+  free(codeBlock->lineNos);
+  codeBlock->code = NULL;
+  codeBlock->lineNos = NULL;
+  codeBlock->codeSize = 0;
+  codeBlock->maxSize = 0;
+}
+
+CodeAddress emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q, int lineNo) {
+  Instruction* inst;
+
+  if (codeBlock->codeSize == codeBlock->maxSize) {
+    codeBlock->maxSize = (codeBlock->maxSize == 0) ? CODE_INITIAL_SIZE : codeBlock->maxSize * 2;
+    codeBlock->code = (Instruction*) realloc(codeBlock->code, codeBlock->maxSize * sizeof(Instruction));
+    codeBlock->lineNos = (int*) realloc(codeBlock->lineNos, codeBlock->maxSize * sizeof(int));
+  }
+  inst = &codeBlock->code[codeBlock->codeSize];
+  inst->op = op;
+  inst->p = p;
+  inst->q = q;
+  codeBlock->lineNos[codeBlock->codeSize] = lineNo;
+  return codeBlock->codeSize ++;
+}
+
+void printInstruction(FILE *f, Instruction* inst) {
+  switch (inst->op) {
+  case OP_LA:
+  case OP_LV:
+  case OP_CALL:
+    fprintf(f, "%s %d,%d", opNames[inst->op], inst->p, inst->q);
+    break;
+  case OP_LC:
+  case OP_INT:
+  case OP_DCT:
+  case OP_J:
+  case OP_FJ:
+  case OP_CHK:
+  case OP_CP:
+    fprintf(f, "%s %d", opNames[inst->op], inst->q);
+    break;
+  default:
+    fprintf(f, "%s", opNames[inst->op]);
+    break;
+  }
+}
+
+void printCodeBlock(FILE *f, CodeBlock* codeBlock) {
+  int i;
+
+  for (i = 0; i < codeBlock->codeSize; i ++) {
+    fprintf(f, "%d:  ", i);
+    printInstruction(f, &codeBlock->code[i]);
+    fprintf(f, "\n");
+  }
+}
@@ -0,0 +1,86 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INSTRUCTIONS_H__
+#define __INSTRUCTIONS_H__
+
+#include <stdio.h>
+
+// Frame layout: every frame starts with these words, then the parameters,
+// then the local variables
+#define RESERVED_WORDS 4
+#define RETURN_VALUE_OFFSET 0
+#define DYNAMIC_LINK_OFFSET 1
+#define RETURN_ADDRESS_OFFSET 2
+#define STATIC_LINK_OFFSET 3
+
+typedef int WORD;
+typedef int CodeAddress;
+
+enum OpCode {
+  OP_LA,   // Load Address:    t := t + 1; s[t] := base(p) + q;
+  OP_LV,   // Load Value:      t := t + 1; s[t] := s[base(p) + q];
+  OP_LC,   // Load Constant    t := t + 1; s[t] := q;
+  OP_LI,   // Load Indirect    s[t] := s[s[t]];
+  OP_INT,  // Increment t      t := t + q;
+  OP_DCT,  // Decrement t      t := t - q;
+  OP_J,    // Jump             pc := q;
+  OP_FJ,   // False Jump       if s[t] = 0 then pc := q; t := t - 1;
+  OP_HL,   // Halt             stop
+  OP_ST,   // Store            s[s[t-1]] := s[t]; t := t - 2;
+  OP_CALL, // Call             s[t+2] := b; s[t+3] := pc; s[t+4] := base(p); b := t + 1; pc := q;
+  OP_EP,   // Exit Procedure   t := b - 1; pc := s[b+2]; b := s[b+1];
+  OP_EF,   // Exit Function    t := b; pc := s[b+2]; b := s[b+1];
+  OP_RC,   // Read Char        t := t + 1; s[t] := next char of the input
+  OP_RI,   // Read Integer     t := t + 1; s[t] := next integer of the input
+  OP_WRC,  // Write Char       write s[t] as a char; t := t - 1;
+  OP_WRI,  // Write Int        write s[t] as an integer; t := t - 1;
+  OP_WLN,  // New Line         write a new line
+  OP_AD,   // Add              t := t - 1; s[t] := s[t] + s[t+1];
+  OP_SB,   // Subtract         t := t - 1; s[t] := s[t] - s[t+1];
+  OP_ML,   // Multiply         t := t - 1; s[t] := s[t] * s[t+1];
+  OP_DV,   // Divide           t := t - 1; s[t] := s[t] / s[t+1];
+  OP_NEG,  // Negative         s[t] := - s[t];
+  OP_CV,   // Copy Top         s[t+1] := s[t]; t := t + 1;
+  OP_EQ,   // Equal            t := t - 1; s[t] := (s[t] = s[t+1]);
+  OP_NE,   // Not Equal        t := t - 1; s[t] := (s[t] != s[t+1]);
+  OP_GT,   // Greater          t := t - 1; s[t] := (s[t] > s[t+1]);
+  OP_LT,   // Less             t := t - 1; s[t] := (s[t] < s[t+1]);
+  OP_GE,   // Greater or Equal t := t - 1; s[t] := (s[t] >= s[t+1]);
+  OP_LE,   // Less or Equal    t := t - 1; s[t] := (s[t] <= s[t+1]);
+  OP_CHK,  // Check Index      error unless 1 <= s[t] <= q
+  OP_CP,   // Copy Block       copy q words from s[t] to s[t-1]; t := t - 2;
+  OP_BP    // Break point      nothing
+};
+
+#define NUM_OF_OPCODES (OP_BP + 1)
+
+struct Instruction_ {
+  enum OpCode op;
+  WORD p;
+  WORD q;
+};
+
+typedef struct Instruction_ Instruction;
+
+struct CodeBlock_ {
+  Instruction* code;
+  int* lineNos;        // source line of each instruction, for runtime errors
+  int codeSize;
+  int maxSize;
+};
+
+typedef struct CodeBlock_ CodeBlock;
+
+void initCodeBlock(CodeBlock* codeBlock);
+void freeCodeBlock(CodeBlock* codeBlock);
+
+CodeAddress emitCode(CodeBlock* codeBlock, enum OpCode op, WORD p, WORD q, int lineNo);
+
+void printInstruction(FILE *f, Instruction* inst);
+void printCodeBlock(FILE *f, CodeBlock* codeBlock);
+
+#endif
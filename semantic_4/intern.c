@@ -0,0 +1,94 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+#include "context.h"
+
+#define INTERN_INITIAL_SIZE 1024
+#define INTERN_BLOCK_SIZE 16384
+
+struct StringBlock_ {
+  struct StringBlock_ *next;
+  int used;
+  char data[INTERN_BLOCK_SIZE];
+};
+
+typedef struct StringBlock_ StringBlock;
+
+unsigned int hashString(char *string, int length) {
+  unsigned int h = 2166136261u;
+  int i;
+  for (i = 0; i < length; i ++)
+    h = (h ^ (unsigned char) string[i]) * 16777619u;
+  return h;
+}
+
+char* storeString(char *string, int length) {
+  char *s;
+  if ((ctx->stringBlocks == NULL) || (ctx->stringBlocks->used + length + 1 > INTERN_BLOCK_SIZE)) {
+    StringBlock* block = (StringBlock*) malloc(sizeof(StringBlock));
+    block->next = ctx->stringBlocks;
+    block->used = 0;
+    ctx->stringBlocks = block;
+  }
+  s = ctx->stringBlocks->data + ctx->stringBlocks->used;
+  memcpy(s, string, length);
+  s[length] = '\0';
+  ctx->stringBlocks->used += length + 1;
+  return s;
+}
+
+void growInternTable(void) {
+  char** oldTable = ctx->internTable;
+  int oldSize = ctx->internSize;
+  int i;
+  unsigned int h;
+
+  ctx->internSize = (oldSize == 0) ? INTERN_INITIAL_SIZE : oldSize * 2;
+  ctx->internTable = (char**) calloc(ctx->internSize, sizeof(char*));
+  for (i = 0; i < oldSize; i ++)
+    if (oldTable[i] != NULL) {
+      h = hashString(oldTable[i], strlen(oldTable[i])) & (ctx->internSize - 1);
+      while (ctx->internTable[h] != NULL)
+        h = (h + 1) & (ctx->internSize - 1);
+      ctx->internTable[h] = oldTable[i];
+    }
+  free(oldTable);
+}
+
+char* internString(char *string, int length) {
+  unsigned int h;
+  char *s;
+
+  if (2 * (ctx->internCount + 1) > ctx->internSize)
+    growInternTable();
+
+  h = hashString(string, length) & (ctx->internSize - 1);
+  while ((s = ctx->internTable[h]) != NULL) {
+    if ((strncmp(s, string, length) == 0) && (s[length] == '\0'))
+      return s;
+    h = (h + 1) & (ctx->internSize - 1);
+  }
+
+  s = storeString(string, length);
+  ctx->internTable[h] = s;
+  ctx->internCount ++;
+  return s;
+}
+
+void freeInternPool(void) {
+  while (ctx->stringBlocks != NULL) {
+    StringBlock* block = ctx->stringBlocks;
+    ctx->stringBlocks = block->next;
+    free(block);
+  }
+  free(ctx->internTable);
+  ctx->internTable = NULL;
+  ctx->internSize = 0;
+  ctx->internCount = 0;
+}
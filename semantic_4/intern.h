@@ -0,0 +1,15 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+// Identifiers are interned: equal names share one copy, so they can be
+// compared by pointer.
+char* internString(char *string, int length);
+void freeInternPool(void);
+
+#endif
@@ -0,0 +1,123 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "jit.h"
+#include "context.h"
+
+#if HAVE_JIT
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#define DEFAULT_STACK_LIMIT (8 << 20)
+#define STACK_RESERVE (256 << 10)     // left to the runtime routines
+
+// The run in progress on this thread. The machine code is relocated with
+// the address of this thread's stackLimit and only runs on this thread.
+static THREAD_LOCAL Console* console;
+static THREAD_LOCAL jmp_buf* abortRun;
+static THREAD_LOCAL VMResult runResult;
+static THREAD_LOCAL char* stackLimit;
+
+static WORD jitReadChar(void) {
+  return readCharacter(console);
+}
+
+static WORD jitReadInteger(void) {
+  return readInteger(console);
+}
+
+static void jitWriteChar(WORD c) {
+  writeCharacter(console, c);
+}
+
+static void jitWriteInteger(WORD value) {
+  writeInteger(console, value);
+}
+
+static void jitWriteLn(void) {
+  writeCharacter(console, '\n');
+}
+
+static void jitError(int lineNo, int error) {
+  flushOutput(console);
+  fflush(stdout);
+  fprintf(stderr, "%d: Runtime error: %s\n", lineNo, vmErrorMessages[error]);
+  runResult = (VMResult) error;
+  longjmp(*abortRun, 1);
+}
+
+static void* routines[] = {
+  [RT_READC] = (void*) jitReadChar,
+  [RT_READI] = (void*) jitReadInteger,
+  [RT_WRITEC] = (void*) jitWriteChar,
+  [RT_WRITEI] = (void*) jitWriteInteger,
+  [RT_WRITELN] = (void*) jitWriteLn,
+  [RT_ERROR] = (void*) jitError
+};
+
+typedef char routinesCheck[(sizeof(routines) / sizeof(routines[0]) == NUM_OF_ROUTINES) ? 1 : -1];
+
+// The lowest address the machine code may push to, some way below top
+static char* findStackLimit(char* top) {
+  struct rlimit limit;
+  long size = DEFAULT_STACK_LIMIT;
+
+  if ((getrlimit(RLIMIT_STACK, &limit) == 0) && (limit.rlim_cur != RLIM_INFINITY)
+      && (limit.rlim_cur < (rlim_t) 1 << 30))
+    size = limit.rlim_cur;
+  return top - size + STACK_RESERVE;
+}
+
+VMResult runJit(X86Code* code) {
+  unsigned char* image;
+  void (*entry)(void);
+  jmp_buf recovery;
+  char top;
+
+  // written while writable, then made executable
+  image = (unsigned char*) mmap(NULL, code->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (image == MAP_FAILED)
+    return VM_INVALID_INSTRUCTION;
+  memcpy(image, code->bytes, code->size);
+  x86Relocate(code, image, routines, &stackLimit);
+  if (mprotect(image, code->size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(image, code->size);
+    return VM_INVALID_INSTRUCTION;
+  }
+
+  console = (Console*) malloc(sizeof(Console));
+  console->inPos = console->inSize = 0;
+  console->outPos = 0;
+  stackLimit = findStackLimit(&top);
+  runResult = VM_OK;
+  abortRun = &recovery;
+
+  entry = (void (*)(void)) (image + code->entry);
+  if (setjmp(recovery) == 0) {
+    entry();
+    flushOutput(console);
+    fflush(stdout);
+  }
+
+  abortRun = NULL;
+  free(console);
+  munmap(image, code->size);
+  return runResult;
+}
+
+#else
+
+VMResult runJit(X86Code* code) {
+  (void) code;
+  return VM_INVALID_INSTRUCTION;
+}
+
+#endif
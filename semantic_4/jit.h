@@ -0,0 +1,25 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __JIT_H__
+#define __JIT_H__
+
+#include "x86.h"
+#include "vm.h"
+
+// The machine code follows the System V calling convention of x86-64
+#if defined(__x86_64__) && !defined(_WIN32)
+#define HAVE_JIT 1
+#else
+#define HAVE_JIT 0
+#endif
+
+// Runs the machine code assembled by genNativeProgram from an executable
+// buffer of this process, with the same input, output and runtime errors
+// as runVM
+VMResult runJit(X86Code* code);
+
+#endif
@@ -0,0 +1,259 @@
+# 
+# @copyright (c) 2008, Hedspi, Hanoi University of Technology
+# @author Huu-Duc Nguyen
+# @version 1.0
+#
+
+# Runtime of the programs compiled with kplc -S, for Linux x86-64 without
+# the C library. The compiled program provides kpl_main.
+#   kplc -S prog.kpl > prog.s
+#   as prog.s -o prog.o && as kplrt.s -o kplrt.o && ld prog.o kplrt.o -o prog
+#
+# The routines follow the C calling convention: the argument is in %edi
+# (and %esi), the result in %eax, and %rbx, %rbp, %r12-%r15 are preserved.
+# Input and output are buffered like in the VM: integers are written with a
+# blank after them, reading skips blanks and gives 0 at the end of the input.
+
+        .set IO_BUFFER_SIZE, 65536
+        .set SYS_READ, 0
+        .set SYS_WRITE, 1
+        .set SYS_EXIT, 60
+        .set SYS_GETRLIMIT, 97
+        .set RLIMIT_STACK, 3
+        .set DEFAULT_STACK, 8 << 20
+        .set STACK_MARGIN, 256 << 10
+
+        .text
+        .globl _start
+_start:
+        # compiled subprograms check %rsp against kpl_stacklimit on entry
+        subq $16, %rsp
+        movl $SYS_GETRLIMIT, %eax
+        movl $RLIMIT_STACK, %edi
+        movq %rsp, %rsi
+        syscall
+        movq (%rsp), %rdx
+        addq $16, %rsp
+        testq %rax, %rax
+        jne 1f
+        cmpq $1 << 30, %rdx           # unlimited or huge
+        jbe 2f
+1:      movq $DEFAULT_STACK, %rdx
+2:      movq %rsp, %rax
+        subq %rdx, %rax
+        addq $STACK_MARGIN, %rax
+        movq %rax, kpl_stacklimit(%rip)
+        call kpl_main
+        call kpl_flush
+        movl $SYS_EXIT, %eax
+        xorl %edi, %edi
+        syscall
+
+# Writes the output buffer to outfd
+kpl_flush:
+        leaq outbuf(%rip), %rsi
+        movq outpos(%rip), %rdx
+1:      testq %rdx, %rdx
+        jle 2f
+        movl $SYS_WRITE, %eax
+        movl outfd(%rip), %edi
+        syscall
+        testq %rax, %rax
+        jle 2f
+        addq %rax, %rsi
+        subq %rax, %rdx
+        jmp 1b
+2:      movq $0, outpos(%rip)
+        ret
+
+        .globl kpl_writec
+kpl_writec:
+        movq outpos(%rip), %rax
+        cmpq $IO_BUFFER_SIZE, %rax
+        jb 1f
+        pushq %rdi
+        call kpl_flush
+        popq %rdi
+        xorl %eax, %eax
+1:      leaq outbuf(%rip), %rcx
+        movb %dil, (%rcx,%rax)
+        incq %rax
+        movq %rax, outpos(%rip)
+        ret
+
+        .globl kpl_writeln
+kpl_writeln:
+        movl $10, %edi
+        jmp kpl_writec
+
+        .globl kpl_writei
+kpl_writei:
+        pushq %rbx
+        subq $16, %rsp
+        movl %edi, %ebx
+        movl %edi, %eax
+        testl %eax, %eax
+        jns 1f
+        negl %eax
+1:      xorl %ecx, %ecx             # the digits, last one first
+        movl $10, %r8d
+2:      xorl %edx, %edx
+        divl %r8d
+        addb $'0', %dl
+        movb %dl, (%rsp,%rcx)
+        incq %rcx
+        testl %eax, %eax
+        jne 2b
+        testl %ebx, %ebx
+        jns 3f
+        movb $'-', (%rsp,%rcx)
+        incq %rcx
+3:      decq %rcx
+        movzbl (%rsp,%rcx), %edi
+        pushq %rcx
+        call kpl_writec
+        popq %rcx
+        testq %rcx, %rcx
+        jne 3b
+        addq $16, %rsp
+        popq %rbx
+        movl $' ', %edi
+        jmp kpl_writec
+
+# The next input character in %eax without reading it, -1 at the end
+kpl_peek:
+        movq inpos(%rip), %rax
+        cmpq insize(%rip), %rax
+        jb 2f
+        call kpl_flush
+        movl $SYS_READ, %eax
+        xorl %edi, %edi
+        leaq inbuf(%rip), %rsi
+        movl $IO_BUFFER_SIZE, %edx
+        syscall
+        movq $0, inpos(%rip)
+        testq %rax, %rax
+        jg 1f
+        movq $0, insize(%rip)
+        movl $-1, %eax
+        ret
+1:      movq %rax, insize(%rip)
+        xorl %eax, %eax
+2:      leaq inbuf(%rip), %rcx
+        movzbl (%rcx,%rax), %eax
+        ret
+
+kpl_skipblanks:
+1:      call kpl_peek
+        cmpl $' ', %eax
+        je 2f
+        cmpl $'\t', %eax
+        je 2f
+        cmpl $'\n', %eax
+        je 2f
+        cmpl $'\r', %eax
+        je 2f
+        ret
+2:      incq inpos(%rip)
+        jmp 1b
+
+        .globl kpl_readc
+kpl_readc:
+        call kpl_skipblanks
+        call kpl_peek
+        cmpl $-1, %eax
+        jne 1f
+        xorl %eax, %eax
+        ret
+1:      incq inpos(%rip)
+        ret
+
+        .globl kpl_readi
+kpl_readi:
+        pushq %rbx                  # the value
+        pushq %r12                  # 1 when negative
+        xorl %ebx, %ebx
+        xorl %r12d, %r12d
+        call kpl_skipblanks
+        call kpl_peek
+        cmpl $'-', %eax
+        jne 1f
+        movl $1, %r12d
+        jmp 2f
+1:      cmpl $'+', %eax
+        jne 3f
+2:      incq inpos(%rip)
+3:      call kpl_peek
+        subl $'0', %eax
+        cmpl $9, %eax
+        ja 4f
+        imull $10, %ebx, %ebx
+        addl %eax, %ebx
+        incq inpos(%rip)
+        jmp 3b
+4:      movl %ebx, %eax
+        testl %r12d, %r12d
+        je 5f
+        negl %eax
+5:      popq %r12
+        popq %rbx
+        ret
+
+# Reports runtime error %esi (a VMResult) at line %edi on stderr and exits
+# with status 2
+        .globl kpl_error
+kpl_error:
+        pushq %rsi
+        pushq %rdi
+        call kpl_flush
+        movl $2, outfd(%rip)
+        popq %rdi
+        call kpl_writei
+        decq outpos(%rip)           # no blank after the line number
+        popq %rsi
+        leaq errorMessages(%rip), %rcx
+        movq (%rcx,%rsi,8), %rsi
+1:      movzbl (%rsi), %edi
+        testl %edi, %edi
+        je 2f
+        pushq %rsi
+        call kpl_writec
+        popq %rsi
+        incq %rsi
+        jmp 1b
+2:      call kpl_flush
+        movl $SYS_EXIT, %eax
+        movl $2, %edi
+        syscall
+
+        .data
+outfd:  .long 1
+        .align 8
+errorMessages:                      # indexed like vmErrorMessages
+        .quad 0
+        .quad stackOverflow
+        .quad indexOutOfRange
+        .quad divisionByZero
+        .quad invalidInstruction
+stackOverflow:
+        .asciz ": Runtime error: Stack overflow.\n"
+indexOutOfRange:
+        .asciz ": Runtime error: Index out of range.\n"
+divisionByZero:
+        .asciz ": Runtime error: Division by zero.\n"
+invalidInstruction:
+        .asciz ": Runtime error: Invalid instruction.\n"
+
+        .bss
+        .align 8
+        .globl kpl_stacklimit
+kpl_stacklimit:
+        .zero 8
+outpos: .zero 8
+inpos:  .zero 8
+insize: .zero 8
+outbuf: .zero IO_BUFFER_SIZE
+inbuf:  .zero IO_BUFFER_SIZE
+
+        # the stack is not executable
+        .section .note.GNU-stack,"",@progbits
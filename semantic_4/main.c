@@ -6,22 +6,143 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "reader.h"
 #include "parser.h"
+#include "error.h"
+#include "context.h"
+#include "batch.h"
+#include "vm.h"
+#include "exec.h"
+#include "jit.h"
 
 /******************************************************************/
 
+// kplc --batch [-j N] [file...]: compile many files in one process,
+// reading the file list from stdin when none is given
+int batchMain(int argc, char *argv[]) {
+  char **fileNames = argv;
+  int fileCount = argc;
+  int threadCount = defaultThreadCount();
+
+  if ((fileCount >= 2) && (strcmp(fileNames[0], "-j") == 0)) {
+    threadCount = atoi(fileNames[1]);
+    fileNames += 2;
+    fileCount -= 2;
+  }
+  if (fileCount == 0)
+    fileCount = readManifest(stdin, &fileNames);
+
+  if (compileBatch(fileNames, fileCount, threadCount) > 0)
+    return 1;
+  return 0;
+}
+
+// How the compiled program is run
+enum RunMode {
+  RUN_NONE,
+  RUN_VM,             // --vm: the reference interpreter
+  RUN_EXEC_SWITCH,    // --exec-switch: the portable engine
+  RUN_EXEC,           // --exec: the threaded engine
+  RUN_JIT,            // --run: machine code, or the threaded engine without a JIT
+  RUN_BENCH           // --bench: all of them, timed
+};
+
+VMResult runProgram(CompilerContext *context, enum RunMode mode) {
+  switch (mode) {
+  case RUN_EXEC_SWITCH:
+    return execCode(&context->code, DEFAULT_STACK_SIZE, ENGINE_SWITCH);
+  case RUN_EXEC:
+    return execCode(&context->code, DEFAULT_STACK_SIZE, ENGINE_THREADED);
+  case RUN_JIT:
+    if (HAVE_JIT)
+      return runJit(&context->native);
+    return execCode(&context->code, DEFAULT_STACK_SIZE, ENGINE_THREADED);
+  default:
+    return runVM(&context->code, DEFAULT_STACK_SIZE);
+  }
+}
+
+// Runs the program on every engine; the times go to stderr so that the
+// program output can be thrown away
+VMResult benchProgram(CompilerContext *context) {
+  static char *names[] = {"vm", "exec-switch", HAVE_THREADED_ENGINE ? "exec" : "exec (switch fallback)", "run"};
+  enum RunMode modes[] = {RUN_VM, RUN_EXEC_SWITCH, RUN_EXEC, RUN_JIT};
+  int engineCount = HAVE_JIT ? 4 : 3;
+  VMResult result = VM_OK;
+  double start, elapsed, reference = 0;
+  int i;
+
+  for (i = 0; (i < engineCount) && (result == VM_OK); i ++) {
+    start = wallClock();
+    result = runProgram(context, modes[i]);
+    elapsed = wallClock() - start;
+    if (i == 0)
+      reference = elapsed;
+    fprintf(stderr, "%-24s %8.3f s %6.2fx\n", names[i], elapsed, (elapsed > 0) ? reference / elapsed : 0);
+  }
+  return result;
+}
+
 int main(int argc, char *argv[]) {
+  CompilerContext *context;
+  int errorCount;
+  enum RunMode mode = RUN_NONE;
+  VMResult result = VM_OK;
+
+  if ((argc > 1) && (strcmp(argv[1], "--batch") == 0))
+    return batchMain(argc - 2, argv + 2);
+
+  context = createContext();
+  while ((argc > 2) && (argv[1][0] == '-')) {
+    if (strcmp(argv[1], "--ast") == 0)
+      context->options |= OPT_DUMP_AST;
+    else if (strcmp(argv[1], "--code") == 0)
+      context->options |= OPT_LIST_CODE;
+    else if (strcmp(argv[1], "-S") == 0)
+      context->options |= OPT_ASM;
+    else if (strcmp(argv[1], "--vm") == 0)
+      mode = RUN_VM;
+    else if (strcmp(argv[1], "--exec") == 0)
+      mode = RUN_EXEC;
+    else if (strcmp(argv[1], "--exec-switch") == 0)
+      mode = RUN_EXEC_SWITCH;
+    else if (strcmp(argv[1], "--run") == 0)
+      mode = RUN_JIT;
+    else if (strcmp(argv[1], "--bench") == 0)
+      mode = RUN_BENCH;
+    else if (strcmp(argv[1], "--parallel-scan") == 0)
+      context->scanThreads = defaultThreadCount();
+    else break;
+    argv ++;
+    argc --;
+  }
+
+  if (mode != RUN_NONE)
+    context->options |= OPT_RUN;
+  if (HAVE_JIT && ((mode == RUN_JIT) || (mode == RUN_BENCH)))
+    context->options |= OPT_JIT;
+
   if (argc <= 1) {
     printf("parser: no input file.\n");
+    freeContext(context);
     return -1;
   }
 
-  if (compile(argv[1]) == IO_ERROR) {
+  if (compile(context, argv[1]) == IO_ERROR) {
     printf("Can\'t read input file!\n");
+    freeContext(context);
     return -1;
   }
-    
-  return 0;
+
+  errorCount = getErrorCount();
+  if ((errorCount == 0) && (mode == RUN_BENCH))
+    result = benchProgram(context);
+  else if ((errorCount == 0) && (mode != RUN_NONE))
+    result = runProgram(context, mode);
+  freeContext(context);
+  if (errorCount > 0)
+    return 1;
+  return (result == VM_OK) ? 0 : 2;
 }
@@ -0,0 +1,675 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "native.h"
+#include "codegen.h"
+#include "regalloc.h"
+#include "vm.h"
+#include "context.h"
+
+// Native frames have the words of the VM frames, 8 bytes each, around %rbp:
+//   16 + 8 * (n - i)(%rbp)   parameter i (from 0) of n, pushed by the caller
+//   16(%rbp)                 static link, pushed by the caller
+//   8(%rbp)                  return address
+//   0(%rbp)                  dynamic link, the caller's %rbp
+// and below them the variables in the order of layoutScope, the return value
+// and the callee-saved registers the subprogram uses. Values are in %eax and
+// addresses in %rax; temporaries are held in %r8-%r10, then pushed. The
+// variables allocateRegisters chose live in callee-saved registers.
+#define SLOT_SIZE 8
+
+static const enum X86Register tempRegisters[] = {X86_R8, X86_R9, X86_R10};
+
+#define NUM_OF_TEMPS ((int) (sizeof(tempRegisters) / sizeof(tempRegisters[0])))
+
+static int paramCount(Scope* scope) {
+  ObjectNode* node;
+  int count = 0;
+
+  for (node = scope->objList; node != NULL; node = node->next)
+    if (node->object->kind == OBJ_PARAMETER)
+      count ++;
+  return count;
+}
+
+// Bytes of the frame below %rbp, kept a multiple of 16
+static int localsSize(Scope* scope) {
+  int size = (scope->frameSize - RESERVED_WORDS - paramCount(scope) + 1) * SLOT_SIZE;
+  return (size + 15) & ~15;
+}
+
+// Where the word at localOffset of a VM frame of the scope is
+static int slotOffset(Scope* scope, int localOffset) {
+  int n = paramCount(scope);
+
+  if (localOffset == RETURN_VALUE_OFFSET)
+    return - (scope->frameSize - RESERVED_WORDS - n + 1) * SLOT_SIZE;
+  if (localOffset < RESERVED_WORDS + n)
+    return 2 * SLOT_SIZE + (n - (localOffset - RESERVED_WORDS)) * SLOT_SIZE;
+  return - (scope->frameSize - localOffset) * SLOT_SIZE;
+}
+
+// The register holding the frame of the scope; static links are followed in %rax
+static enum X86Register frameOf(Scope* scope) {
+  int distance = levelDistance(scope);
+
+  if (distance == 0)
+    return X86_RBP;
+  x86Load(8, X86_RAX, X86_RBP, 2 * SLOT_SIZE);
+  while (-- distance > 0)
+    x86Load(8, X86_RAX, X86_RAX, 2 * SLOT_SIZE);
+  return X86_RAX;
+}
+
+// Bytes below the frame's variables where the callee-saved registers are kept
+static int savedSize(void) {
+  int k, count = 0;
+
+  for (k = 0; k < NUM_OF_X86_REGISTERS; k ++)
+    if (ctx->registers.savedRegisters & (1 << k))
+      count ++;
+  return (count * SLOT_SIZE + 15) & ~15;
+}
+
+// Saves (or restores) the callee-saved registers the subprogram uses
+static void genSavedRegisters(Scope* scope, int save) {
+  int k, offset = - localsSize(scope);
+
+  for (k = 0; k < NUM_OF_X86_REGISTERS; k ++)
+    if (ctx->registers.savedRegisters & (1 << k)) {
+      offset -= SLOT_SIZE;
+      if (save)
+        x86Store(8, X86_RBP, offset, k);
+      else x86Load(8, k, X86_RBP, offset);
+    }
+}
+
+static int isReference(Object* obj) {
+  return (obj->kind == OBJ_PARAMETER) && (obj->paramAttrs->kind == PARAM_REFERENCE);
+}
+
+// The register holding a variable or a parameter of the current scope, or 0
+static enum X86Register registerOf(Object* obj) {
+  if ((obj->kind == OBJ_VARIABLE) && (levelDistance(obj->varAttrs->scope) == 0))
+    return obj->varAttrs->nativeRegister;
+  if ((obj->kind == OBJ_PARAMETER) && (levelDistance(ownerScope(obj->paramAttrs->function)) == 0))
+    return obj->paramAttrs->nativeRegister;
+  return 0;
+}
+
+// Where a variable or a parameter of the current scope is in its frame
+static int frameSlot(Object* obj) {
+  if (obj->kind == OBJ_VARIABLE)
+    return slotOffset(obj->varAttrs->scope, obj->varAttrs->localOffset);
+  return slotOffset(ownerScope(obj->paramAttrs->function), obj->paramAttrs->localOffset);
+}
+
+// Stores (or reloads) the registers of the variables a call may reach
+static void genExposed(int store) {
+  Object* obj;
+  int i;
+
+  for (i = 0; i < ctx->registers.exposedCount; i ++) {
+    obj = ctx->registers.exposed[i];
+    if (store)
+      x86Store(4, X86_RBP, frameSlot(obj), registerOf(obj));
+    else x86Load(4, registerOf(obj), X86_RBP, frameSlot(obj));
+  }
+}
+
+// Holds %rax as a temporary
+static void pushTemp(void) {
+  if (ctx->registers.temps < NUM_OF_TEMPS)
+    x86Op(X86_MOV, 8, tempRegisters[ctx->registers.temps], X86_RAX);
+  else x86Push(X86_RAX);
+  ctx->registers.temps ++;
+}
+
+// Moves the last temporary held to reg
+static void popTemp(enum X86Register reg) {
+  ctx->registers.temps --;
+  if (ctx->registers.temps < NUM_OF_TEMPS)
+    x86Op(X86_MOV, 8, reg, tempRegisters[ctx->registers.temps]);
+  else x86Pop(reg);
+}
+
+// Calls do not keep %r8-%r10: the temporaries held there go to the stack
+static int saveTemps(void) {
+  int k, held = ctx->registers.temps;
+
+  for (k = 0; (k < held) && (k < NUM_OF_TEMPS); k ++)
+    x86Push(tempRegisters[k]);
+  ctx->registers.temps = 0;
+  return held;
+}
+
+static void restoreTemps(int held) {
+  int k;
+
+  for (k = ((held < NUM_OF_TEMPS) ? held : NUM_OF_TEMPS); k > 0; k --)
+    x86Pop(tempRegisters[k - 1]);
+  ctx->registers.temps = held;
+}
+
+// Operands that are read without %rax or a temporary: constants, and the
+// integers and characters of the current frame
+static int isSimple(NodeId id) {
+  AstNode* node = AST_NODE(id);
+  Object* obj;
+
+  if ((node->kind == AST_NUMBER) || (node->kind == AST_CHAR))
+    return 1;
+  if (node->kind != AST_VARIABLE)
+    return 0;
+  obj = node->object;
+  if (obj->kind == OBJ_VARIABLE)
+    return (obj->varAttrs->type->typeClass != TP_ARRAY) && (levelDistance(obj->varAttrs->scope) == 0);
+  if (obj->kind == OBJ_PARAMETER)
+    return !isReference(obj) && (levelDistance(ownerScope(obj->paramAttrs->function)) == 0);
+  return 0;
+}
+
+// The register with the value of a simple operand, loaded into scratch
+// unless it is a variable's
+static enum X86Register genSimple(NodeId id, enum X86Register scratch) {
+  AstNode* node = AST_NODE(id);
+  enum X86Register reg;
+
+  if ((node->kind == AST_NUMBER) || (node->kind == AST_CHAR)) {
+    x86MovImm(scratch, node->value);
+    return scratch;
+  }
+  reg = registerOf(node->object);
+  if (reg != 0)
+    return reg;
+  x86Load(4, scratch, X86_RBP, frameSlot(node->object));
+  return scratch;
+}
+
+// reg := reg op the simple operand
+static void genSimpleOp(enum X86Op op, enum X86Register reg, NodeId id) {
+  AstNode* node = AST_NODE(id);
+
+  if ((node->kind == AST_NUMBER) || (node->kind == AST_CHAR))
+    x86OpImm(op, 4, reg, node->value);
+  else x86Op(op, 4, reg, genSimple(id, X86_RCX));
+}
+
+// Whether evaluating the expression calls a subprogram
+static int hasCall(NodeId id) {
+  AstNode* node;
+
+  if (id == 0) return 0;
+  node = AST_NODE(id);
+  if ((node->kind == AST_CALL) || (node->kind == AST_CALL_ST))
+    return 1;
+  return hasCall(node->a) || hasCall(node->b);
+}
+
+// Reports a runtime error unless the flags satisfy cond
+static void genRuntimeCheck(enum X86Condition cond, VMResult error, NodeId id) {
+  X86Label ok = x86NewLabel();
+
+  x86Jcc(cond, ok);
+  x86MovImm(X86_RDI, ctx->positions[id].lineNo);
+  x86MovImm(X86_RSI, error);
+  x86CallRuntime(RT_ERROR);
+  x86Label(ok);
+}
+
+/******************************************************************/
+
+void genNativeSubprogram(Object* owner, Scope* scope, X86Label label) {
+  ObjectNode* node;
+  Object* obj;
+
+  // labels for the nested subprograms first, the body may call them
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION)
+      obj->funcAttrs->codeAddress = x86NewLabel();
+    else if (obj->kind == OBJ_PROCEDURE)
+      obj->procAttrs->codeAddress = x86NewLabel();
+  }
+
+  if (owner->kind == OBJ_PROGRAM)
+    x86Global("kpl_main");
+  else x86Function(label, owner->name);
+
+  enterBlock(scope);
+  allocateRegisters(scope, &ctx->registers);
+  x86Push(X86_RBP);
+  x86Op(X86_MOV, 8, X86_RBP, X86_RSP);
+  x86OpImm(X86_SUB, 8, X86_RSP, localsSize(scope) + savedSize());
+  x86CompareStackLimit();
+  genRuntimeCheck(X86_AE, VM_STACK_OVERFLOW, scope->body);
+  genSavedRegisters(scope, 1);
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if ((obj->kind == OBJ_PARAMETER) && (obj->paramAttrs->nativeRegister != 0))
+      x86Load(isReference(obj) ? 8 : 4, obj->paramAttrs->nativeRegister, X86_RBP, frameSlot(obj));
+  }
+
+  genNativeStatement(scope->body);
+  if (owner->kind == OBJ_FUNCTION)
+    x86Load(4, X86_RAX, X86_RBP, slotOffset(scope, RETURN_VALUE_OFFSET));
+  genSavedRegisters(scope, 0);
+  x86Op(X86_MOV, 8, X86_RSP, X86_RBP);
+  x86Pop(X86_RBP);
+  x86Ret();
+  exitBlock();
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION)
+      genNativeSubprogram(obj, obj->funcAttrs->scope, obj->funcAttrs->codeAddress);
+    else if (obj->kind == OBJ_PROCEDURE)
+      genNativeSubprogram(obj, obj->procAttrs->scope, obj->procAttrs->codeAddress);
+  }
+}
+
+void genNativeProgram(Object* program, FILE* f) {
+  x86Begin(f);
+  genNativeSubprogram(program, program->progAttrs->scope, 0);
+  x86Finish();
+}
+
+/******************************************************************/
+
+void genNativeStatement(NodeId id) {
+  AstNode* node;
+  NodeId st;
+  X86Label start, falseLabel, endLabel;
+  Type* type;
+  enum X86Register reg = 0;
+
+  if (id == 0) return;
+  node = AST_NODE(id);
+
+  switch (node->kind) {
+  case AST_ASSIGN:
+    type = nodeType(node->a);
+    if (AST_NODE(node->a)->kind == AST_VARIABLE)
+      reg = registerOf(AST_NODE(node->a)->object);
+    if ((reg != 0) || isSimple(node->a)) {
+      genNativeValue(node->b);
+      if (reg == 0)
+        x86Store(4, X86_RBP, frameSlot(AST_NODE(node->a)->object), X86_RAX);
+      else if (isReference(AST_NODE(node->a)->object))
+        x86Store(4, reg, 0, X86_RAX);
+      else x86Op(X86_MOV, 4, reg, X86_RAX);
+      break;
+    }
+    genNativeAddress(node->a);
+    pushTemp();
+    if (type->typeClass == TP_ARRAY) {
+      genNativeAddress(node->b);
+      x86Op(X86_MOV, 8, X86_RSI, X86_RAX);
+      popTemp(X86_RDI);
+      x86MovImm(X86_RCX, sizeOfType(type));
+      x86CopyWords();
+    } else {
+      genNativeValue(node->b);
+      popTemp(X86_RCX);
+      x86Store(4, X86_RCX, 0, X86_RAX);
+    }
+    break;
+  case AST_CALL_ST:
+    genNativeCall(id);
+    break;
+  case AST_BLOCK:
+    for (st = node->a; st != 0; st = AST_NODE(st)->next)
+      genNativeStatement(st);
+    break;
+  case AST_IF:
+    falseLabel = x86NewLabel();
+    genNativeCondition(node->a, falseLabel);
+    genNativeStatement(node->b);
+    if (node->c != 0) {
+      endLabel = x86NewLabel();
+      x86Jmp(endLabel);
+      x86Label(falseLabel);
+      genNativeStatement(node->c);
+      x86Label(endLabel);
+    } else x86Label(falseLabel);
+    break;
+  case AST_WHILE:
+    start = x86NewLabel();
+    falseLabel = x86NewLabel();
+    x86Label(start);
+    genNativeCondition(node->a, falseLabel);
+    genNativeStatement(node->b);
+    x86Jmp(start);
+    x86Label(falseLabel);
+    break;
+  case AST_FOR:
+    start = x86NewLabel();
+    falseLabel = x86NewLabel();
+    reg = registerOf(AST_NODE(node->a)->object);
+    if (reg != 0) {
+      genNativeValue(node->b);
+      x86Op(X86_MOV, 4, reg, X86_RAX);
+      x86Label(start);
+      if (isSimple(node->c))
+        genSimpleOp(X86_CMP, reg, node->c);
+      else {
+        genNativeValue(node->c);
+        x86Op(X86_CMP, 4, reg, X86_RAX);
+      }
+      x86Jcc(X86_G, falseLabel);
+      genNativeStatement(node->body);
+      x86OpImm(X86_ADD, 4, reg, 1);
+      x86Jmp(start);
+      x86Label(falseLabel);
+      break;
+    }
+    // the variable's address stays on the stack for the whole loop
+    genNativeAddress(node->a);
+    x86Push(X86_RAX);
+    genNativeValue(node->b);
+    x86Load(8, X86_RCX, X86_RSP, 0);
+    x86Store(4, X86_RCX, 0, X86_RAX);
+
+    x86Label(start);
+    genNativeValue(node->c);
+    x86Load(8, X86_RCX, X86_RSP, 0);
+    x86Load(4, X86_RDX, X86_RCX, 0);
+    x86Op(X86_CMP, 4, X86_RDX, X86_RAX);
+    x86Jcc(X86_G, falseLabel);
+
+    genNativeStatement(node->body);
+
+    x86Load(8, X86_RCX, X86_RSP, 0);
+    x86Load(4, X86_RAX, X86_RCX, 0);
+    x86OpImm(X86_ADD, 4, X86_RAX, 1);
+    x86Store(4, X86_RCX, 0, X86_RAX);
+    x86Jmp(start);
+    x86Label(falseLabel);
+    x86OpImm(X86_ADD, 8, X86_RSP, SLOT_SIZE);
+    break;
+  default:
+    break;
+  }
+}
+
+static enum X86Condition conditionOf(int op) {
+  switch (op) {
+  case SB_EQ: return X86_E;
+  case SB_NEQ: return X86_NE;
+  case SB_LT: return X86_L;
+  case SB_LE: return X86_LE;
+  case SB_GT: return X86_G;
+  default: return X86_GE;
+  }
+}
+
+// Evaluates the two operands into %eax and %ecx; a simple first operand is
+// read after the second one instead of being held, unless a call in between
+// may change it
+static void genOperands(NodeId id) {
+  NodeId a = AST_NODE(id)->a;
+
+  if (isSimple(a) && !hasCall(AST_NODE(id)->b)) {
+    genNativeValue(AST_NODE(id)->b);
+    x86Op(X86_MOV, 4, X86_RCX, X86_RAX);
+    genNativeValue(a);
+    return;
+  }
+  genNativeValue(a);
+  pushTemp();
+  genNativeValue(AST_NODE(id)->b);
+  x86Op(X86_MOV, 4, X86_RCX, X86_RAX);
+  popTemp(X86_RAX);
+}
+
+// Sets the flags for the operands of a comparison
+static void genCompare(NodeId id) {
+  if (isSimple(AST_NODE(id)->b)) {
+    genNativeValue(AST_NODE(id)->a);
+    genSimpleOp(X86_CMP, X86_RAX, AST_NODE(id)->b);
+  } else {
+    genOperands(id);
+    x86Op(X86_CMP, 4, X86_RAX, X86_RCX);
+  }
+}
+
+void genNativeCondition(NodeId id, X86Label falseLabel) {
+  AstNode* node = AST_NODE(id);
+
+  if (node->kind == AST_CONDITION) {
+    genCompare(id);
+    x86Jcc(x86Negate(conditionOf(AST_NODE(id)->op)), falseLabel);
+  } else {
+    genNativeValue(id);
+    x86Op(X86_TEST, 4, X86_RAX, X86_RAX);
+    x86Jcc(X86_E, falseLabel);
+  }
+}
+
+void genNativeValue(NodeId id) {
+  AstNode* node = AST_NODE(id);
+  Object* obj;
+  enum X86Register base, reg;
+  X86Label divide, done;
+  int offset;
+
+  switch (node->kind) {
+  case AST_NUMBER:
+  case AST_CHAR:
+    x86MovImm(X86_RAX, node->value);
+    break;
+  case AST_VARIABLE:
+    obj = node->object;
+    reg = registerOf(obj);
+    if (reg != 0) {
+      if (isReference(obj))
+        x86Load(4, X86_RAX, reg, 0);
+      else x86Op(X86_MOV, 4, X86_RAX, reg);
+    } else if (obj->kind == OBJ_VARIABLE) {
+      if (obj->varAttrs->type->typeClass == TP_ARRAY)
+        genNativeAddress(id);
+      else {
+        base = frameOf(obj->varAttrs->scope);
+        x86Load(4, X86_RAX, base, slotOffset(obj->varAttrs->scope, obj->varAttrs->localOffset));
+      }
+    } else if (obj->kind == OBJ_PARAMETER) {
+      genNativeAddress(id);
+      x86Load(4, X86_RAX, X86_RAX, 0);
+    } else genNativeAddress(id);
+    break;
+  case AST_INDEX:
+    if ((node->type->typeClass != TP_ARRAY) && knownLocation(id, &obj, &offset)) {
+      base = frameOf(obj->varAttrs->scope);
+      x86Load(4, X86_RAX, base, slotOffset(obj->varAttrs->scope, offset));
+      break;
+    }
+    genNativeAddress(id);
+    if (node->type->typeClass != TP_ARRAY)
+      x86Load(4, X86_RAX, X86_RAX, 0);
+    break;
+  case AST_CALL:
+    genNativeCall(id);
+    break;
+  case AST_NEGATE:
+    genNativeValue(node->a);
+    x86Neg(X86_RAX);
+    break;
+  case AST_BINARY:
+    if (isSimple(node->b) && (node->op != SB_SLASH)) {
+      genNativeValue(node->a);
+      genSimpleOp((node->op == SB_PLUS) ? X86_ADD : ((node->op == SB_MINUS) ? X86_SUB : X86_IMUL), X86_RAX, node->b);
+      break;
+    }
+    genOperands(id);
+    switch (node->op) {
+    case SB_PLUS:
+      x86Op(X86_ADD, 4, X86_RAX, X86_RCX);
+      break;
+    case SB_MINUS:
+      x86Op(X86_SUB, 4, X86_RAX, X86_RCX);
+      break;
+    case SB_TIMES:
+      x86Op(X86_IMUL, 4, X86_RAX, X86_RCX);
+      break;
+    case SB_SLASH:
+      // dividing by -1 is a negation, idiv would trap on the smallest integer
+      divide = x86NewLabel();
+      done = x86NewLabel();
+      x86Op(X86_TEST, 4, X86_RCX, X86_RCX);
+      genRuntimeCheck(X86_NE, VM_DIVISION_BY_ZERO, id);
+      x86OpImm(X86_CMP, 4, X86_RCX, -1);
+      x86Jcc(X86_NE, divide);
+      x86Neg(X86_RAX);
+      x86Jmp(done);
+      x86Label(divide);
+      x86Cltd();
+      x86Idiv(X86_RCX);
+      x86Label(done);
+      break;
+    default:
+      break;
+    }
+    break;
+  case AST_CONDITION:
+    genCompare(id);
+    x86Setcc(conditionOf(node->op), X86_RAX);
+    break;
+  default:
+    break;
+  }
+}
+
+void genNativeAddress(NodeId id) {
+  AstNode* node = AST_NODE(id);
+  Object* obj;
+  Scope* scope;
+  enum X86Register base, reg;
+  Type* arrayType;
+  int elementSize, offset;
+
+  switch (node->kind) {
+  case AST_VARIABLE:
+    obj = node->object;
+    if (isReference(obj) && ((reg = registerOf(obj)) != 0)) {
+      x86Op(X86_MOV, 8, X86_RAX, reg);
+      break;
+    }
+    // a variable in a register is only asked for its address as the
+    // argument of a call, which stores it in the frame first
+    switch (obj->kind) {
+    case OBJ_VARIABLE:
+      base = frameOf(obj->varAttrs->scope);
+      x86Lea(X86_RAX, base, slotOffset(obj->varAttrs->scope, obj->varAttrs->localOffset));
+      break;
+    case OBJ_PARAMETER:
+      scope = ownerScope(obj->paramAttrs->function);
+      base = frameOf(scope);
+      if (obj->paramAttrs->kind == PARAM_REFERENCE)
+        x86Load(8, X86_RAX, base, slotOffset(scope, obj->paramAttrs->localOffset));
+      else
+        x86Lea(X86_RAX, base, slotOffset(scope, obj->paramAttrs->localOffset));
+      break;
+    case OBJ_FUNCTION:
+      // the return value, in the function's own frame
+      base = frameOf(obj->funcAttrs->scope);
+      x86Lea(X86_RAX, base, slotOffset(obj->funcAttrs->scope, RETURN_VALUE_OFFSET));
+      break;
+    default:
+      break;
+    }
+    break;
+  case AST_INDEX:
+    // indexes run from 1 to the array size
+    arrayType = nodeType(node->a);
+    elementSize = sizeOfType(node->type);
+    if (knownLocation(id, &obj, &offset)) {
+      base = frameOf(obj->varAttrs->scope);
+      x86Lea(X86_RAX, base, slotOffset(obj->varAttrs->scope, offset));
+      break;
+    }
+    genNativeAddress(node->a);
+    if (knownIndex(id)) {
+      offset = (AST_NODE(node->b)->value - 1) * elementSize;
+      if (offset != 0)
+        x86OpImm(X86_ADD, 8, X86_RAX, offset * SLOT_SIZE);
+      break;
+    }
+    if (isSimple(node->b)) {
+      reg = genSimple(node->b, X86_RCX);
+      if (reg != X86_RCX)
+        x86Op(X86_MOV, 4, X86_RCX, reg);
+    } else {
+      pushTemp();
+      genNativeValue(node->b);
+      x86Op(X86_MOV, 4, X86_RCX, X86_RAX);
+      popTemp(X86_RAX);
+    }
+    x86OpImm(X86_SUB, 4, X86_RCX, 1);
+    if (!(node->flags & NODE_IN_RANGE)) {
+      x86OpImm(X86_CMP, 4, X86_RCX, arrayType->arraySize - 1);
+      genRuntimeCheck(X86_BE, VM_INDEX_OUT_OF_RANGE, id);
+    }
+    x86OpImm(X86_IMUL, 8, X86_RCX, elementSize * SLOT_SIZE);
+    x86Op(X86_ADD, 8, X86_RAX, X86_RCX);
+    break;
+  default:
+    break;
+  }
+}
+
+static enum RuntimeRoutine runtimeRoutine(enum OpCode op) {
+  switch (op) {
+  case OP_RC: return RT_READC;
+  case OP_RI: return RT_READI;
+  case OP_WRC: return RT_WRITEC;
+  case OP_WRI: return RT_WRITEI;
+  default: return RT_WRITELN;
+  }
+}
+
+void genNativeCall(NodeId id) {
+  Object* obj = AST_NODE(id)->object;
+  enum OpCode op = builtinOp(obj);
+  ObjectNode* param;
+  Scope* scope;
+  NodeId arg;
+  int argCount = 0;
+  int held = saveTemps();
+
+  if (op != OP_BP) {
+    for (arg = AST_NODE(id)->a; arg != 0; arg = AST_NODE(arg)->next) {
+      genNativeValue(arg);
+      x86Op(X86_MOV, 4, X86_RDI, X86_RAX);
+    }
+    x86CallRuntime(runtimeRoutine(op));
+    restoreTemps(held);
+    return;
+  }
+
+  if (obj->kind == OBJ_FUNCTION) {
+    param = obj->funcAttrs->paramList;
+    scope = obj->funcAttrs->scope;
+  } else {
+    param = obj->procAttrs->paramList;
+    scope = obj->procAttrs->scope;
+  }
+
+  for (arg = AST_NODE(id)->a; arg != 0; arg = AST_NODE(arg)->next) {
+    if (param->object->paramAttrs->kind == PARAM_REFERENCE)
+      genNativeAddress(arg);
+    else genNativeValue(arg);
+    x86Push(X86_RAX);
+    param = param->next;
+    argCount ++;
+  }
+  x86Push(frameOf(scope->outer));
+  genExposed(1);
+  x86Call((obj->kind == OBJ_FUNCTION) ? obj->funcAttrs->codeAddress : obj->procAttrs->codeAddress);
+  x86OpImm(X86_ADD, 8, X86_RSP, (argCount + 1) * SLOT_SIZE);
+  genExposed(0);
+  restoreTemps(held);
+}
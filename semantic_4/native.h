@@ -0,0 +1,27 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __NATIVE_H__
+#define __NATIVE_H__
+
+#include "symtab.h"
+#include "x86.h"
+
+// Translates the checked program, after genProgram has laid out its scopes,
+// into x86-64 assembly for the runtime in kplrt.s:
+//   kplc -S prog.kpl > prog.s
+//   as prog.s -o prog.o && as kplrt.s -o kplrt.o && ld prog.o kplrt.o -o prog
+// or, when f is NULL, into machine code in ctx->native for runJit.
+void genNativeProgram(Object* program, FILE* f);
+
+void genNativeSubprogram(Object* owner, Scope* scope, X86Label label);
+void genNativeStatement(NodeId id);
+void genNativeCondition(NodeId id, X86Label falseLabel);
+void genNativeValue(NodeId id);
+void genNativeAddress(NodeId id);
+void genNativeCall(NodeId id);
+
+#endif
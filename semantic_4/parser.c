@@ -12,34 +12,72 @@
 #include "semantics.h"
 #include "error.h"
 #include "debug.h"
-
-Token *currentToken;
-Token *lookAhead;
-
-extern Type* intType;
-extern Type* charType;
-extern SymTab* symtab;
+#include "intern.h"
+#include "codegen.h"
+#include "native.h"
+#include "fold.h"
+#include "range.h"
+#include "context.h"
+
+// Tokens live by value in a small ring. lookAhead is the slot at ringHead,
+// currentToken the one before it, and up to TOKEN_RING_SIZE - 2 further
+// tokens can be scanned ahead with peekToken().
+
+Token* peekToken(int k) {
+  // k = 1 is lookAhead; k must stay below TOKEN_RING_SIZE so currentToken is kept
+  while (ctx->ringCount < k) {
+    if (ctx->tokenStream.tokens != NULL)
+      getPrescannedToken(&ctx->tokenRing[(ctx->ringHead + ctx->ringCount) & TOKEN_RING_MASK]);
+    else getValidToken(&ctx->tokenRing[(ctx->ringHead + ctx->ringCount) & TOKEN_RING_MASK]);
+    ctx->ringCount ++;
+  }
+  return &ctx->tokenRing[(ctx->ringHead + k - 1) & TOKEN_RING_MASK];
+}
 
 void scan(void) {
-  Token* tmp = currentToken;
-  currentToken = lookAhead;
-  lookAhead = getValidToken();
-  free(tmp);
+  ctx->currentToken = ctx->lookAhead;
+  ctx->ringHead = (ctx->ringHead + 1) & TOKEN_RING_MASK;
+  ctx->ringCount --;
+  ctx->lookAhead = peekToken(1);
 }
 
 void eat(TokenType tokenType) {
-  if (lookAhead->tokenType == tokenType) {
+  if (ctx->lookAhead->tokenType == tokenType) {
+    scan();
+  } else missingToken(tokenType, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
+}
+
+NodeId makeNode(enum NodeKind kind, Token *token) {
+  return newNode(kind, token->lineNo, token->colNo);
+}
+
+/******************* Error recovery ******************************/
+
+// Panic mode: after an error, skip to a token the enclosing construct can resume at
+
+void skipStatement(void) {
+  while ((ctx->lookAhead->tokenType != SB_SEMICOLON) && (ctx->lookAhead->tokenType != KW_END) &&
+         (ctx->lookAhead->tokenType != KW_ELSE) && (ctx->lookAhead->tokenType != TK_EOF))
     scan();
-  } else missingToken(tokenType, lookAhead->lineNo, lookAhead->colNo);
 }
 
+void skipDeclaration(void) {
+  while ((ctx->lookAhead->tokenType != SB_SEMICOLON) && (ctx->lookAhead->tokenType != KW_BEGIN) &&
+         (ctx->lookAhead->tokenType != KW_END) && (ctx->lookAhead->tokenType != TK_EOF))
+    scan();
+  if (ctx->lookAhead->tokenType == SB_SEMICOLON)
+    scan();
+}
+
+/******************************************************************/
+
 void compileProgram(void) {
   Object* program;
 
   eat(KW_PROGRAM);
   eat(TK_IDENT);
 
-  program = createProgramObject(currentToken->string);
+  program = createProgramObject(ctx->currentToken->ident);
   enterBlock(program->progAttrs->scope);
 
   eat(SB_SEMICOLON);
@@ -53,24 +91,30 @@ void compileProgram(void) {
 void compileBlock(void) {
   Object* constObj;
   ConstantValue* constValue;
+  jmp_buf recovery;
+  jmp_buf *outer = ctx->panicHandler;
 
-  if (lookAhead->tokenType == KW_CONST) {
+  if (ctx->lookAhead->tokenType == KW_CONST) {
     eat(KW_CONST);
 
     do {
-      eat(TK_IDENT);
-      
-      checkFreshIdent(currentToken->string);
-      constObj = createConstantObject(currentToken->string);
-      
-      eat(SB_EQ);
-      constValue = compileConstant();
-      
-      constObj->constAttrs->value = constValue;
-      declareObject(constObj);
-      
-      eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
+      ctx->panicHandler = &recovery;
+      if (setjmp(recovery) == 0) {
+        eat(TK_IDENT);
+
+        checkFreshIdent(ctx->currentToken->ident);
+        constObj = createConstantObject(ctx->currentToken->ident);
+
+        eat(SB_EQ);
+        constValue = compileConstant();
+
+        constObj->constAttrs->value = constValue;
+        declareObject(constObj);
+
+        eat(SB_SEMICOLON);
+      } else skipDeclaration();
+      ctx->panicHandler = outer;
+    } while (ctx->lookAhead->tokenType == TK_IDENT);
 
     compileBlock2();
   } 
@@ -80,24 +124,30 @@ void compileBlock(void) {
 void compileBlock2(void) {
   Object* typeObj;
   Type* actualType;
+  jmp_buf recovery;
+  jmp_buf *outer = ctx->panicHandler;
 
-  if (lookAhead->tokenType == KW_TYPE) {
+  if (ctx->lookAhead->tokenType == KW_TYPE) {
     eat(KW_TYPE);
 
     do {
-      eat(TK_IDENT);
-      
-      checkFreshIdent(currentToken->string);
-      typeObj = createTypeObject(currentToken->string);
-      
-      eat(SB_EQ);
-      actualType = compileType();
-      
-      typeObj->typeAttrs->actualType = actualType;
-      declareObject(typeObj);
-      
-      eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
+      ctx->panicHandler = &recovery;
+      if (setjmp(recovery) == 0) {
+        eat(TK_IDENT);
+
+        checkFreshIdent(ctx->currentToken->ident);
+        typeObj = createTypeObject(ctx->currentToken->ident);
+
+        eat(SB_EQ);
+        actualType = compileType();
+
+        typeObj->typeAttrs->actualType = actualType;
+        declareObject(typeObj);
+
+        eat(SB_SEMICOLON);
+      } else skipDeclaration();
+      ctx->panicHandler = outer;
+    } while (ctx->lookAhead->tokenType == TK_IDENT);
 
     compileBlock3();
   } 
@@ -107,24 +157,30 @@ void compileBlock2(void) {
 void compileBlock3(void) {
   Object* varObj;
   Type* varType;
+  jmp_buf recovery;
+  jmp_buf *outer = ctx->panicHandler;
 
-  if (lookAhead->tokenType == KW_VAR) {
+  if (ctx->lookAhead->tokenType == KW_VAR) {
     eat(KW_VAR);
 
     do {
-      eat(TK_IDENT);
-      
-      checkFreshIdent(currentToken->string);
-      varObj = createVariableObject(currentToken->string);
-
-      eat(SB_COLON);
-      varType = compileType();
-      
-      varObj->varAttrs->type = varType;
-      declareObject(varObj);
-      
-      eat(SB_SEMICOLON);
-    } while (lookAhead->tokenType == TK_IDENT);
+      ctx->panicHandler = &recovery;
+      if (setjmp(recovery) == 0) {
+        eat(TK_IDENT);
+
+        checkFreshIdent(ctx->currentToken->ident);
+        varObj = createVariableObject(ctx->currentToken->ident);
+
+        eat(SB_COLON);
+        varType = compileType();
+
+        varObj->varAttrs->type = varType;
+        declareObject(varObj);
+
+        eat(SB_SEMICOLON);
+      } else skipDeclaration();
+      ctx->panicHandler = outer;
+    } while (ctx->lookAhead->tokenType == TK_IDENT);
 
     compileBlock4();
   } 
@@ -137,14 +193,21 @@ void compileBlock4(void) {
 }
 
 void compileBlock5(void) {
+  Scope* scope = ctx->symtab->currentScope;
+  NodeId body, statements;
+
   eat(KW_BEGIN);
-  compileStatements();
+  body = makeNode(AST_BLOCK, ctx->currentToken);
+  statements = compileStatements();
   eat(KW_END);
+
+  AST_NODE(body)->a = statements;
+  scope->body = body;
 }
 
 void compileSubDecls(void) {
-  while ((lookAhead->tokenType == KW_FUNCTION) || (lookAhead->tokenType == KW_PROCEDURE)) {
-    if (lookAhead->tokenType == KW_FUNCTION)
+  while ((ctx->lookAhead->tokenType == KW_FUNCTION) || (ctx->lookAhead->tokenType == KW_PROCEDURE)) {
+    if (ctx->lookAhead->tokenType == KW_FUNCTION)
       compileFuncDecl();
     else compileProcDecl();
   }
@@ -153,23 +216,37 @@ void compileSubDecls(void) {
 void compileFuncDecl(void) {
   Object* funcObj;
   Type* returnType;
+  jmp_buf recovery;
+  jmp_buf *outer = ctx->panicHandler;
 
   eat(KW_FUNCTION);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  funcObj = createFunctionObject(currentToken->string);
-  declareObject(funcObj);
+  funcObj = createFunctionObject(ctx->currentToken->ident);
+
+  ctx->panicHandler = &recovery;
+  if (setjmp(recovery) == 0) {
+    checkFreshIdent(funcObj->name);
+    declareObject(funcObj);
 
-  enterBlock(funcObj->funcAttrs->scope);
+    enterBlock(funcObj->funcAttrs->scope);
   
-  compileParams();
+    compileParams();
 
-  eat(SB_COLON);
-  returnType = compileBasicType();
-  funcObj->funcAttrs->returnType = returnType;
+    eat(SB_COLON);
+    returnType = compileBasicType();
+    funcObj->funcAttrs->returnType = returnType;
+
+    eat(SB_SEMICOLON);
+  } else {
+    // go on with the body in the function's own scope
+    enterBlock(funcObj->funcAttrs->scope);
+    if (funcObj->funcAttrs->returnType == NULL)
+      funcObj->funcAttrs->returnType = makeIntType();
+    skipDeclaration();
+  }
+  ctx->panicHandler = outer;
 
-  eat(SB_SEMICOLON);
   compileBlock();
   eat(SB_SEMICOLON);
 
@@ -178,19 +255,30 @@ void compileFuncDecl(void) {
 
 void compileProcDecl(void) {
   Object* procObj;
+  jmp_buf recovery;
+  jmp_buf *outer = ctx->panicHandler;
 
   eat(KW_PROCEDURE);
   eat(TK_IDENT);
 
-  checkFreshIdent(currentToken->string);
-  procObj = createProcedureObject(currentToken->string);
-  declareObject(procObj);
+  procObj = createProcedureObject(ctx->currentToken->ident);
 
-  enterBlock(procObj->procAttrs->scope);
+  ctx->panicHandler = &recovery;
+  if (setjmp(recovery) == 0) {
+    checkFreshIdent(procObj->name);
+    declareObject(procObj);
 
-  compileParams();
+    enterBlock(procObj->procAttrs->scope);
+
+    compileParams();
+
+    eat(SB_SEMICOLON);
+  } else {
+    enterBlock(procObj->procAttrs->scope);
+    skipDeclaration();
+  }
+  ctx->panicHandler = outer;
 
-  eat(SB_SEMICOLON);
   compileBlock();
   eat(SB_SEMICOLON);
 
@@ -201,24 +289,24 @@ ConstantValue* compileUnsignedConstant(void) {
   ConstantValue* constValue;
   Object* obj;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    constValue = makeIntConstant(currentToken->value);
+    constValue = makeIntConstant(ctx->currentToken->value);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
 
-    obj = checkDeclaredConstant(currentToken->string);
+    obj = checkDeclaredConstant(ctx->currentToken->ident);
     constValue = duplicateConstantValue(obj->constAttrs->value);
 
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
+    constValue = makeCharConstant(ctx->currentToken->string[0]);
     break;
   default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_CONSTANT, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     break;
   }
   return constValue;
@@ -227,7 +315,7 @@ ConstantValue* compileUnsignedConstant(void) {
 ConstantValue* compileConstant(void) {
   ConstantValue* constValue;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case SB_PLUS:
     eat(SB_PLUS);
     constValue = compileConstant2();
@@ -239,7 +327,7 @@ ConstantValue* compileConstant(void) {
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    constValue = makeCharConstant(currentToken->string[0]);
+    constValue = makeCharConstant(ctx->currentToken->string[0]);
     break;
   default:
     constValue = compileConstant2();
@@ -252,21 +340,21 @@ ConstantValue* compileConstant2(void) {
   ConstantValue* constValue;
   Object* obj;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    constValue = makeIntConstant(currentToken->value);
+    constValue = makeIntConstant(ctx->currentToken->value);
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredConstant(currentToken->string);
+    obj = checkDeclaredConstant(ctx->currentToken->ident);
     if (obj->constAttrs->value->type == TP_INT)
       constValue = duplicateConstantValue(obj->constAttrs->value);
     else
-      error(ERR_UNDECLARED_INT_CONSTANT,currentToken->lineNo, currentToken->colNo);
+      error(ERR_UNDECLARED_INT_CONSTANT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
     break;
   default:
-    error(ERR_INVALID_CONSTANT, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_CONSTANT, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     break;
   }
   return constValue;
@@ -278,7 +366,7 @@ Type* compileType(void) {
   int arraySize;
   Object* obj;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case KW_INTEGER: 
     eat(KW_INTEGER);
     type =  makeIntType();
@@ -292,7 +380,7 @@ Type* compileType(void) {
     eat(SB_LSEL);
     eat(TK_NUMBER);
 
-    arraySize = currentToken->value;
+    arraySize = ctx->currentToken->value;
 
     eat(SB_RSEL);
     eat(KW_OF);
@@ -301,11 +389,11 @@ Type* compileType(void) {
     break;
   case TK_IDENT:
     eat(TK_IDENT);
-    obj = checkDeclaredType(currentToken->string);
+    obj = checkDeclaredType(ctx->currentToken->ident);
     type = duplicateType(obj->typeAttrs->actualType);
     break;
   default:
-    error(ERR_INVALID_TYPE, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_TYPE, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     break;
   }
   return type;
@@ -314,7 +402,7 @@ Type* compileType(void) {
 Type* compileBasicType(void) {
   Type* type;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case KW_INTEGER: 
     eat(KW_INTEGER); 
     type = makeIntType();
@@ -324,17 +412,17 @@ Type* compileBasicType(void) {
     type = makeCharType();
     break;
   default:
-    error(ERR_INVALID_BASICTYPE, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_BASICTYPE, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     break;
   }
   return type;
 }
 
 void compileParams(void) {
-  if (lookAhead->tokenType == SB_LPAR) {
+  if (ctx->lookAhead->tokenType == SB_LPAR) {
     eat(SB_LPAR);
     compileParam();
-    while (lookAhead->tokenType == SB_SEMICOLON) {
+    while (ctx->lookAhead->tokenType == SB_SEMICOLON) {
       eat(SB_SEMICOLON);
       compileParam();
     }
@@ -347,7 +435,7 @@ void compileParam(void) {
   Type* type;
   enum ParamKind paramKind;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case TK_IDENT:
     paramKind = PARAM_VALUE;
     break;
@@ -356,46 +444,64 @@ void compileParam(void) {
     paramKind = PARAM_REFERENCE;
     break;
   default:
-    error(ERR_INVALID_PARAMETER, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_PARAMETER, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     break;
   }
 
   eat(TK_IDENT);
-  checkFreshIdent(currentToken->string);
-  param = createParameterObject(currentToken->string, paramKind, symtab->currentScope->owner);
+  checkFreshIdent(ctx->currentToken->ident);
+  param = createParameterObject(ctx->currentToken->ident, paramKind, ctx->symtab->currentScope->owner);
   eat(SB_COLON);
   type = compileBasicType();
   param->paramAttrs->type = type;
   declareObject(param);
 }
 
-void compileStatements(void) {
-  compileStatement();
-  while (lookAhead->tokenType == SB_SEMICOLON) {
+NodeId compileStatements(void) {
+  NodeId first, last, st;
+
+  first = last = compileStatement();
+  while (ctx->lookAhead->tokenType == SB_SEMICOLON) {
     eat(SB_SEMICOLON);
-    compileStatement();
+    st = compileStatement();
+    if (st == 0) continue;
+    if (last == 0) first = st;
+    else AST_NODE(last)->next = st;
+    last = st;
   }
+  return first;
 }
 
-void compileStatement(void) {
-  switch (lookAhead->tokenType) {
+NodeId compileStatement(void) {
+  NodeId st = 0;
+  jmp_buf recovery;
+  jmp_buf *outer = ctx->panicHandler;
+
+  ctx->panicHandler = &recovery;
+  if (setjmp(recovery) != 0) {
+    ctx->panicHandler = outer;
+    skipStatement();
+    return 0;
+  }
+
+  switch (ctx->lookAhead->tokenType) {
   case TK_IDENT:
-    compileAssignSt();
+    st = compileAssignSt();
     break;
   case KW_CALL:
-    compileCallSt();
+    st = compileCallSt();
     break;
   case KW_BEGIN:
-    compileGroupSt();
+    st = compileGroupSt();
     break;
   case KW_IF:
-    compileIfSt();
+    st = compileIfSt();
     break;
   case KW_WHILE:
-    compileWhileSt();
+    st = compileWhileSt();
     break;
   case KW_FOR:
-    compileForSt();
+    st = compileForSt();
     break;
     // EmptySt needs to check FOLLOW tokens
   case SB_SEMICOLON:
@@ -404,139 +510,191 @@ void compileStatement(void) {
     break;
     // Error occurs
   default:
-    error(ERR_INVALID_STATEMENT, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_STATEMENT, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     break;
   }
+
+  ctx->panicHandler = outer;
+  return st;
 }
 
-Type* compileLValue(void) {
+NodeId compileLValue(void) {
   // parse a lvalue (a variable, an array element, a parameter, the current function identifier)
   Object* var = NULL;
-  Type* varType = NULL;
+  NodeId lvalue;
 
   eat(TK_IDENT);
   // check if the identifier is a function identifier, or a variable identifier, or a parameter  
-  var = checkDeclaredLValueIdent(currentToken->string);
+  var = checkDeclaredLValueIdent(ctx->currentToken->ident);
+  lvalue = makeNode(AST_VARIABLE, ctx->currentToken);
+  AST_NODE(lvalue)->object = var;
   if (var->kind == OBJ_VARIABLE)
-    varType = compileIndexes(var->varAttrs->type);
-  else if (var->kind == OBJ_FUNCTION)
-    varType = var->funcAttrs->returnType;
-  else if (var->kind == OBJ_PARAMETER)
-    varType = var->paramAttrs->type;
+    lvalue = compileIndexes(lvalue);
 
-  return varType;
+  return lvalue;
 }
 
-void compileAssignSt(void) {
+NodeId compileAssignSt(void) {
   // parse the assignment and check type consistency
-  Type *lvalueType = NULL;
-  Type *expType = NULL;
+  NodeId st, lvalue, exp;
 
-  lvalueType = compileLValue();
+  lvalue = compileLValue();
   eat(SB_ASSIGN);
-  expType = compileExpression();
-  checkTypeEquality(lvalueType, expType);
+  st = makeNode(AST_ASSIGN, ctx->currentToken);
+  exp = compileExpression();
+  checkTypeEquality(nodeType(lvalue), nodeType(exp));
+
+  AST_NODE(st)->a = lvalue;
+  AST_NODE(st)->b = exp;
+  return st;
 }
 
-void compileCallSt(void) {
+NodeId compileCallSt(void) {
   Object* proc;
+  NodeId st, args;
 
   eat(KW_CALL);
   eat(TK_IDENT);
 
-  proc = checkDeclaredProcedure(currentToken->string);
+  st = makeNode(AST_CALL_ST, ctx->currentToken);
+  proc = checkDeclaredProcedure(ctx->currentToken->ident);
+
+  args = compileArguments(proc->procAttrs->paramList);
 
-  compileArguments(proc->procAttrs->paramList);
+  AST_NODE(st)->object = proc;
+  AST_NODE(st)->a = args;
+  return st;
 }
 
-void compileGroupSt(void) {
+NodeId compileGroupSt(void) {
+  NodeId st, body;
+
   eat(KW_BEGIN);
-  compileStatements();
+  st = makeNode(AST_BLOCK, ctx->currentToken);
+  body = compileStatements();
   eat(KW_END);
+
+  AST_NODE(st)->a = body;
+  return st;
 }
 
-void compileIfSt(void) {
+NodeId compileIfSt(void) {
+  NodeId st, cond, thenSt, elseSt = 0;
+
   eat(KW_IF);
-  compileCondition();
+  st = makeNode(AST_IF, ctx->currentToken);
+  cond = compileCondition();
   eat(KW_THEN);
-  compileStatement();
-  if (lookAhead->tokenType == KW_ELSE) 
-    compileElseSt();
+  thenSt = compileStatement();
+  if (ctx->lookAhead->tokenType == KW_ELSE) 
+    elseSt = compileElseSt();
+
+  AST_NODE(st)->a = cond;
+  AST_NODE(st)->b = thenSt;
+  AST_NODE(st)->c = elseSt;
+  return st;
 }
 
-void compileElseSt(void) {
+NodeId compileElseSt(void) {
   eat(KW_ELSE);
-  compileStatement();
+  return compileStatement();
 }
 
-void compileWhileSt(void) {
+NodeId compileWhileSt(void) {
+  NodeId st, cond, body;
+
   eat(KW_WHILE);
-  compileCondition();
+  st = makeNode(AST_WHILE, ctx->currentToken);
+  cond = compileCondition();
   eat(KW_DO);
-  compileStatement();
+  body = compileStatement();
+
+  AST_NODE(st)->a = cond;
+  AST_NODE(st)->b = body;
+  return st;
 }
 
-void compileForSt(void) {
+NodeId compileForSt(void) {
   // Check type consistency of FOR's variable
+  NodeId st, var, exp1, exp2, body;
+
   eat(KW_FOR);
+  st = makeNode(AST_FOR, ctx->currentToken);
   eat(TK_IDENT);
 
   // check if the identifier is a variable
-  Object *var = checkDeclaredVariable(currentToken->string);
-  checkBasicType(var->varAttrs->type);
+  Object *varObj = checkDeclaredVariable(ctx->currentToken->ident);
+  checkBasicType(varObj->varAttrs->type);
+  var = makeNode(AST_VARIABLE, ctx->currentToken);
+  AST_NODE(var)->object = varObj;
 
   eat(SB_ASSIGN);
-  Type *exp1Type = compileExpression();
+  exp1 = compileExpression();
+  Type *exp1Type = nodeType(exp1);
   checkBasicType(exp1Type);
 
   eat(KW_TO);
-  Type *exp2Type = compileExpression();
+  exp2 = compileExpression();
+  Type *exp2Type = nodeType(exp2);
   checkBasicType(exp2Type);
 
   // Compare 3 types
-  checkTypeEquality(var->varAttrs->type, exp1Type);
+  checkTypeEquality(varObj->varAttrs->type, exp1Type);
   checkTypeEquality(exp1Type, exp2Type);
 
   eat(KW_DO);
-  compileStatement();
+  body = compileStatement();
+
+  AST_NODE(st)->a = var;
+  AST_NODE(st)->b = exp1;
+  AST_NODE(st)->c = exp2;
+  AST_NODE(st)->body = body;
+  return st;
 }
 
-void compileArgument(Object* param) {
+NodeId compileArgument(Object* param) {
   // parse an argument, and check type consistency
   //       If the corresponding parameter is a reference, the argument must be a lvalue
   if (param->paramAttrs->kind == PARAM_REFERENCE) {
-    if (lookAhead->tokenType == TK_IDENT) {
-        checkDeclaredLValueIdent(lookAhead->string);
+    if (ctx->lookAhead->tokenType == TK_IDENT) {
+        checkDeclaredLValueIdent(ctx->lookAhead->ident);
     } else {
-        error(ERR_TYPE_INCONSISTENCY, lookAhead->lineNo, lookAhead->colNo);
+        error(ERR_TYPE_INCONSISTENCY, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
     }
   }
 
-  Type *argType = compileExpression();
-  checkTypeEquality(argType, param->paramAttrs->type);
+  NodeId arg = compileExpression();
+  checkTypeEquality(nodeType(arg), param->paramAttrs->type);
 
+  return arg;
 }
 
-void compileArguments(ObjectNode* paramList) {
+NodeId compileArguments(ObjectNode* paramList) {
   // parse a list of arguments, check the consistency of the arguments and the given parameters
-  switch (lookAhead->tokenType) {
+  NodeId first = 0, last, arg;
+
+  switch (ctx->lookAhead->tokenType) {
   case SB_LPAR:
     eat(SB_LPAR);
-    compileArgument(paramList->object);
+    if (paramList == NULL)
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
+    first = last = compileArgument(paramList->object);
 
-    while (lookAhead->tokenType == SB_COMMA) {
+    while (ctx->lookAhead->tokenType == SB_COMMA) {
       eat(SB_COMMA);
       paramList = paramList->next;
-      if (paramList != NULL)
-        compileArgument(paramList->object);
-      else
-        error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+      if (paramList != NULL) {
+        arg = compileArgument(paramList->object);
+        AST_NODE(last)->next = arg;
+        last = arg;
+      } else
+        error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
     }
     
     // param list still has next one when we've done parsing arguments
     // means number of arguments doesn't match number of params
     if (paramList->next != NULL)
-      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+      error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
     eat(SB_RPAR);
     break;
@@ -561,20 +719,24 @@ void compileArguments(ObjectNode* paramList) {
   case KW_ELSE:
   case KW_THEN:
     // Param list exists but we don't see left parenthesis
-    if (paramList->object != NULL)
-          error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    if (paramList != NULL)
+          error(ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
     break;
   default:
-    error(ERR_INVALID_ARGUMENTS, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_ARGUMENTS, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
   }
+  return first;
 }
 
-void compileCondition(void) {
+NodeId compileCondition(void) {
   // check the type consistency of LHS and RSH, check the basic type
-  Type *exp1 = compileExpression();
-  checkBasicType(exp1);
+  NodeId cond, exp1, exp2;
+
+  exp1 = compileExpression();
+  Type *exp1Type = nodeType(exp1);
+  checkBasicType(exp1Type);
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case SB_EQ:
     eat(SB_EQ);
     break;
@@ -594,62 +756,68 @@ void compileCondition(void) {
     eat(SB_GT);
     break;
   default:
-    error(ERR_INVALID_COMPARATOR, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_COMPARATOR, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
   }
+  cond = makeNode(AST_CONDITION, ctx->currentToken);
+  AST_NODE(cond)->op = ctx->currentToken->tokenType;
 
-  Type *exp2 = compileExpression();
-  checkBasicType(exp2);
+  exp2 = compileExpression();
+  Type *exp2Type = nodeType(exp2);
+  checkBasicType(exp2Type);
 
   // Compare 2 sides
-  checkTypeEquality(exp1, exp2);
+  checkTypeEquality(exp1Type, exp2Type);
+
+  AST_NODE(cond)->a = exp1;
+  AST_NODE(cond)->b = exp2;
+  return cond;
 }
 
-Type* compileExpression(void) {
-  Type* type;
+NodeId compileExpression(void) {
+  NodeId exp, operand;
   
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case SB_PLUS:
     eat(SB_PLUS);
-    type = compileExpression2();
-    checkIntType(type);
+    exp = compileExpression2();
+    checkIntType(nodeType(exp));
     break;
   case SB_MINUS:
     eat(SB_MINUS);
-    type = compileExpression2();
-    checkIntType(type);
+    exp = makeNode(AST_NEGATE, ctx->currentToken);
+    operand = compileExpression2();
+    checkIntType(nodeType(operand));
+    AST_NODE(exp)->a = operand;
     break;
   default:
-    type = compileExpression2();
+    exp = compileExpression2();
   }
-  return type;
+  return exp;
 }
 
-Type* compileExpression2(void) {
-  Type* type;
-
-  type = compileTerm();
-  compileExpression3();
+NodeId compileExpression2(void) {
+  NodeId term;
 
-  return type;
+  term = compileTerm();
+  return compileExpression3(term);
 }
 
 
-void compileExpression3(void) {
-  Type* type;
+NodeId compileExpression3(NodeId left) {
+  // left is the expression so far: the operators are left associative
+  NodeId exp, term;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case SB_PLUS:
-    eat(SB_PLUS);
-    type = compileTerm();
-    checkIntType(type);
-    compileExpression3();
-    break;
   case SB_MINUS:
-    eat(SB_MINUS);
-    type = compileTerm();
-    checkIntType(type);
-    compileExpression3();
-    break;
+    eat(ctx->lookAhead->tokenType);
+    exp = makeNode(AST_BINARY, ctx->currentToken);
+    AST_NODE(exp)->op = ctx->currentToken->tokenType;
+    term = compileTerm();
+    checkIntType(nodeType(term));
+    AST_NODE(exp)->a = left;
+    AST_NODE(exp)->b = term;
+    return compileExpression3(exp);
     // check the FOLLOW set
   case KW_TO:
   case KW_DO:
@@ -668,35 +836,32 @@ void compileExpression3(void) {
   case KW_THEN:
     break;
   default:
-    error(ERR_INVALID_EXPRESSION, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_EXPRESSION, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
   }
+  return left;
 }
 
-Type* compileTerm(void) {
-  Type* type;
-
-  type = compileFactor();
-  compileTerm2();
+NodeId compileTerm(void) {
+  NodeId factor;
 
-  return type;
+  factor = compileFactor();
+  return compileTerm2(factor);
 }
 
-void compileTerm2(void) {
-  Type* type;
+NodeId compileTerm2(NodeId left) {
+  NodeId term, factor;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case SB_TIMES:
-    eat(SB_TIMES);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
   case SB_SLASH:
-    eat(SB_SLASH);
-    type = compileFactor();
-    checkIntType(type);
-    compileTerm2();
-    break;
+    eat(ctx->lookAhead->tokenType);
+    term = makeNode(AST_BINARY, ctx->currentToken);
+    AST_NODE(term)->op = ctx->currentToken->tokenType;
+    factor = compileFactor();
+    checkIntType(nodeType(factor));
+    AST_NODE(term)->a = left;
+    AST_NODE(term)->b = factor;
+    return compileTerm2(term);
     // check the FOLLOW set
   case SB_PLUS:
   case SB_MINUS:
@@ -717,107 +882,153 @@ void compileTerm2(void) {
   case KW_THEN:
     break;
   default:
-    error(ERR_INVALID_TERM, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_TERM, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
   }
+  return left;
 }
 
-Type* compileFactor(void) {
-  // parse a factor and return the factor's type
+NodeId compileFactor(void) {
+  // parse a factor and return its node, whose type is given by nodeType()
 
   Object* obj = NULL;
-  Type* type = NULL;
+  NodeId factor = 0;
+  NodeId args;
 
-  switch (lookAhead->tokenType) {
+  switch (ctx->lookAhead->tokenType) {
   case TK_NUMBER:
     eat(TK_NUMBER);
-    type = makeIntType();
+    factor = makeNode(AST_NUMBER, ctx->currentToken);
+    AST_NODE(factor)->value = ctx->currentToken->value;
     break;
   case TK_CHAR:
     eat(TK_CHAR);
-    type = makeCharType();
+    factor = makeNode(AST_CHAR, ctx->currentToken);
+    AST_NODE(factor)->value = (unsigned char) ctx->currentToken->string[0];
     break;
   case TK_IDENT:
     eat(TK_IDENT);
     // check if the identifier is declared
-    obj = checkDeclaredIdent(currentToken->string);
+    obj = checkDeclaredIdent(ctx->currentToken->ident);
 
     switch (obj->kind) {
     case OBJ_CONSTANT:
-      // use as an empty type
-      type = makeIntType();
-
-      // assign the type of the constant
-      type->typeClass = obj->constAttrs->value->type;
+      // a constant is replaced by its value
+      if (obj->constAttrs->value->type == TP_INT) {
+        factor = makeNode(AST_NUMBER, ctx->currentToken);
+        AST_NODE(factor)->value = obj->constAttrs->value->intValue;
+      } else {
+        factor = makeNode(AST_CHAR, ctx->currentToken);
+        AST_NODE(factor)->value = (unsigned char) obj->constAttrs->value->charValue;
+      }
       break;
     case OBJ_VARIABLE:
-      if (obj->varAttrs->type->typeClass != TP_ARRAY)
-        type = obj->varAttrs->type;
-      else
-        type = compileIndexes(obj->varAttrs->type);
+      factor = makeNode(AST_VARIABLE, ctx->currentToken);
+      AST_NODE(factor)->object = obj;
+      if (obj->varAttrs->type->typeClass == TP_ARRAY)
+        factor = compileIndexes(factor);
       break;
     case OBJ_PARAMETER:
-      type = obj->paramAttrs->type;
+      factor = makeNode(AST_VARIABLE, ctx->currentToken);
+      AST_NODE(factor)->object = obj;
       break;
     case OBJ_FUNCTION:
-      type = obj->funcAttrs->returnType;
-      compileArguments(obj->funcAttrs->paramList);
+      factor = makeNode(AST_CALL, ctx->currentToken);
+      AST_NODE(factor)->object = obj;
+      args = compileArguments(obj->funcAttrs->paramList);
+      AST_NODE(factor)->a = args;
       break;
     default: 
-      error(ERR_INVALID_FACTOR,currentToken->lineNo, currentToken->colNo);
+      error(ERR_INVALID_FACTOR,ctx->currentToken->lineNo, ctx->currentToken->colNo);
       break;
     }
     break;
   default:
-    error(ERR_INVALID_FACTOR, lookAhead->lineNo, lookAhead->colNo);
+    error(ERR_INVALID_FACTOR, ctx->lookAhead->lineNo, ctx->lookAhead->colNo);
   }
   
-  return type;
+  return factor;
 }
 
-Type* compileIndexes(Type* arrayType) {
-  // parse a sequence of indexes, check the consistency to the arrayType, and return the element type
-  Type *idxType = NULL;
-  Type *elmType = NULL;
+NodeId compileIndexes(NodeId array) {
+  // parse a sequence of indexes, check the consistency to the array's type, and return the element
+  Type *arrayType = nodeType(array);
+  NodeId element, index;
 
-  while (lookAhead->tokenType == SB_LSEL) {
+  while (ctx->lookAhead->tokenType == SB_LSEL) {
     eat(SB_LSEL);
+    element = makeNode(AST_INDEX, ctx->currentToken);
 
     // if current element is not of array type,
     // then the access to the next dimension is invalid
     checkArrayType(arrayType);
 
-    idxType = compileExpression();
-    checkIntType(idxType);
+    index = compileExpression();
+    checkIntType(nodeType(index));
 
     eat(SB_RSEL);
 
     // Down 1 level of dimension
     arrayType = arrayType->elementType;
-  }
 
-  // arrayType becomes elmType when we traverse to the last dimension
-  elmType = arrayType;
+    AST_NODE(element)->a = array;
+    AST_NODE(element)->b = index;
+    AST_NODE(element)->type = arrayType;
+    array = element;
+  }
 
-  return elmType;
+  // array is the last element when we traverse to the last dimension
+  return array;
 }
 
-int compile(char *fileName) {
+int compile(CompilerContext *context, char *fileName) {
+  jmp_buf recovery;
+
+  useContext(context);
   if (openInputStream(fileName) == IO_ERROR)
     return IO_ERROR;
 
-  currentToken = NULL;
-  lookAhead = getValidToken();
+  clearErrors();
+  resetAst();
+  if (ctx->scanThreads > 1)
+    prescanInput(ctx->scanThreads);
 
-  initSymTab();
+  ctx->ringHead = 0;
+  ctx->ringCount = 0;
+  ctx->currentToken = NULL;
+  ctx->lookAhead = peekToken(1);
 
-  compileProgram();
+  initSymTab();
 
-  printObject(symtab->program,0);
+  // errors that no construct recovers from end the parse
+  ctx->panicHandler = &recovery;
+  if (setjmp(recovery) == 0)
+    compileProgram();
+  ctx->panicHandler = NULL;
+
+  initCodeBlock(&ctx->code);
+  // the range analysis reports indexes that are always out of range
+  if (getErrorCount() == 0) {
+    foldProgram(ctx->symtab->program);
+    analyzeRanges(ctx->symtab->program);
+  }
+  if ((getErrorCount() == 0) && (ctx->options & (OPT_LIST_CODE | OPT_RUN | OPT_ASM | OPT_JIT)))
+    genProgram(ctx->symtab->program);
+  if ((getErrorCount() == 0) && (ctx->options & OPT_JIT))
+    genNativeProgram(ctx->symtab->program, NULL);
+
+  if (getErrorCount() > 0)
+    printErrors();
+  else if (ctx->options & OPT_ASM)
+    genNativeProgram(ctx->symtab->program, ctx->output);
+  else if (ctx->options & OPT_LIST_CODE)
+    printCodeBlock(ctx->output, &ctx->code);
+  else if (!(ctx->options & OPT_RUN))
+    printObject(ctx->symtab->program,0);
 
   cleanSymTab();
+  freeInternPool();
+  freeTokenStream(&ctx->tokenStream);
 
-  free(currentToken);
-  free(lookAhead);
   closeInputStream();
   return IO_SUCCESS;
 
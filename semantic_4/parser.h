@@ -7,9 +7,12 @@
 #define __PARSER_H__
 #include "token.h"
 #include "symtab.h"
+#include "context.h"
 
+Token* peekToken(int k);
 void scan(void);
 void eat(TokenType tokenType);
+NodeId makeNode(enum NodeKind kind, Token *token);
 
 void compileProgram(void);
 void compileBlock(void);
@@ -33,27 +36,28 @@ Type* compileType(void);
 Type* compileBasicType(void);
 void compileParams(void);
 void compileParam(void);
-void compileStatements(void);
-void compileStatement(void);
-Type* compileLValue(void);
-void compileAssignSt(void);
-void compileCallSt(void);
-void compileGroupSt(void);
-void compileIfSt(void);
-void compileElseSt(void);
-void compileWhileSt(void);
-void compileForSt(void);
-void compileArgument(Object* param);
-void compileArguments(ObjectNode* paramList);
-void compileCondition(void);
-Type* compileExpression(void);
-Type* compileExpression2(void);
-void compileExpression3(void);
-Type* compileTerm(void);
-void compileTerm2(void);
-Type* compileFactor(void);
-Type* compileIndexes(Type* arrayType);
+NodeId compileStatements(void);
+NodeId compileStatement(void);
+NodeId compileLValue(void);
+NodeId compileAssignSt(void);
+NodeId compileCallSt(void);
+NodeId compileGroupSt(void);
+NodeId compileIfSt(void);
+NodeId compileElseSt(void);
+NodeId compileWhileSt(void);
+NodeId compileForSt(void);
+NodeId compileArgument(Object* param);
+NodeId compileArguments(ObjectNode* paramList);
+NodeId compileCondition(void);
+NodeId compileExpression(void);
+NodeId compileExpression2(void);
+NodeId compileExpression3(NodeId left);
+NodeId compileTerm(void);
+NodeId compileTerm2(NodeId left);
+NodeId compileFactor(void);
+NodeId compileIndexes(NodeId array);
 
-int compile(char *fileName);
+// Compiles fileName with the given context, which stays the current one afterwards
+int compile(CompilerContext *context, char *fileName);
 
 #endif
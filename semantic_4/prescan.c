@@ -0,0 +1,260 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "reader.h"
+#include "scanner.h"
+#include "intern.h"
+#include "prescan.h"
+#include "context.h"
+
+#define MAX_CHUNKS 256
+#define MIN_CHUNK_SIZE (1024 * 1024)
+#define NO_ERROR (-1)
+
+// A part of the input scanned by one thread, with a context of its own:
+// tokens that start at an offset below limit are the chunk's
+struct Chunk_ {
+  CompilerContext *context;
+  char *buffer;
+  long size;
+  char *start;
+  long limit;
+  int lineCount;            // newlines in the chunk
+  Token *tokens;
+  long *offsets;            // where each token starts
+  int *errors;              // each token's error, or NO_ERROR
+  int count;
+  int capacity;
+  long next;                // where the first token after the chunk starts
+  int nextError;            // and its error
+};
+
+typedef struct Chunk_ Chunk;
+
+static void addChunkToken(Chunk *chunk, Token *token, long offset, int error) {
+  if (chunk->count == chunk->capacity) {
+    chunk->capacity = (chunk->capacity == 0) ? 4096 : chunk->capacity * 2;
+    chunk->tokens = (Token*) realloc(chunk->tokens, chunk->capacity * sizeof(Token));
+    chunk->offsets = (long*) realloc(chunk->offsets, chunk->capacity * sizeof(long));
+    chunk->errors = (int*) realloc(chunk->errors, chunk->capacity * sizeof(int));
+  }
+  chunk->tokens[chunk->count] = *token;
+  chunk->offsets[chunk->count] = offset;
+  chunk->errors[chunk->count] = error;
+  chunk->count ++;
+}
+
+// Scans the chunk from from on, in the chunk's context
+static void scanChunk(Chunk *chunk, char *from) {
+  Token token;
+  long offset;
+  int error;
+
+  useContext(chunk->context);
+  openInputRange(chunk->buffer, chunk->size, chunk->start, from);
+  chunk->count = 0;
+  for (;;) {
+    ctx->diagnosticCount = 0;
+    getToken(&token);
+    offset = ctx->lineMarks[token.lineNo - 1] + token.colNo;
+    error = (ctx->diagnosticCount > 0) ? (int) ctx->diagnostics[0].errorCode : NO_ERROR;
+    if (offset >= chunk->limit) {
+      chunk->next = offset;
+      chunk->nextError = error;
+      break;
+    }
+    addChunkToken(chunk, &token, offset, error);
+    if (token.tokenType == TK_EOF)
+      break;
+  }
+  closeInputRange();
+}
+
+static void* chunkWorker(void *arg) {
+  Chunk *chunk = (Chunk*) arg;
+  char *p = chunk->start;
+  char *end = chunk->buffer + ((chunk->limit < chunk->size) ? chunk->limit : chunk->size);
+
+  scanChunk(chunk, chunk->start);
+  while ((p = (char*) memchr(p, '\n', end - p)) != NULL) {
+    chunk->lineCount ++;
+    p ++;
+  }
+  return NULL;
+}
+
+/******************************************************************/
+
+static void addToken(TokenStream *stream, Token *token) {
+  if (stream->count == stream->capacity) {
+    stream->capacity = (stream->capacity == 0) ? 4096 : stream->capacity * 2;
+    stream->tokens = (Token*) realloc(stream->tokens, stream->capacity * sizeof(Token));
+  }
+  stream->tokens[stream->count ++] = *token;
+}
+
+static void addError(TokenStream *stream, int token, int errorCode) {
+  if (stream->errorCount == stream->errorCapacity) {
+    stream->errorCapacity = (stream->errorCapacity == 0) ? 64 : stream->errorCapacity * 2;
+    stream->errors = (ScanError*) realloc(stream->errors, stream->errorCapacity * sizeof(ScanError));
+  }
+  stream->errors[stream->errorCount].token = token;
+  stream->errors[stream->errorCount].errorCode = errorCode;
+  stream->errorCount ++;
+}
+
+// The index of the chunk's token that starts at offset, or -1
+static int findToken(Chunk *chunk, long offset) {
+  int lo = 0, hi = chunk->count - 1, mid;
+
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (chunk->offsets[mid] == offset)
+      return mid;
+    if (chunk->offsets[mid] < offset) lo = mid + 1;
+    else hi = mid - 1;
+  }
+  return -1;
+}
+
+// Appends the chunks' tokens in order, in the main context: lines are
+// numbered from the start of the input and identifiers interned again
+static void mergeChunks(CompilerContext *owner, Chunk *chunks, int chunkCount) {
+  TokenStream *stream = &owner->tokenStream;
+  Chunk *chunk;
+  Token *token;
+  long expected = 0;        // where the next token starts
+  int carried = NO_ERROR;   // and its error
+  int lineBase = 0;
+  int i, k, first;
+
+  for (i = 0; i < chunkCount; i ++) {
+    chunk = &chunks[i];
+    if (expected >= chunk->limit) {
+      // all inside a comment that started before
+      lineBase += chunk->lineCount;
+      continue;
+    }
+    first = findToken(chunk, expected);
+    if (first < 0) {
+      scanChunk(chunk, chunk->buffer + expected);
+      first = 0;
+    }
+    if (i > 0)
+      chunk->errors[first] = carried;
+
+    useContext(owner);
+    for (k = first; k < chunk->count; k ++) {
+      token = &chunk->tokens[k];
+      token->lineNo += lineBase;
+      if (token->tokenType == TK_IDENT)
+        token->ident = internString(token->string, strlen(token->string));
+      if (chunk->errors[k] != NO_ERROR)
+        addError(stream, stream->count, chunk->errors[k]);
+      addToken(stream, token);
+    }
+    expected = chunk->next;
+    carried = chunk->nextError;
+    lineBase += chunk->lineCount;
+  }
+}
+
+void prescanInput(int threadCount) {
+  CompilerContext *owner = ctx;
+  Chunk chunks[MAX_CHUNKS];
+  pthread_t threads[MAX_CHUNKS];
+  int started[MAX_CHUNKS];
+  char *buffer = ctx->inputBuffer;
+  long size = ctx->inputSize;
+  long step, offset = 0;
+  char *p;
+  int i, chunkCount = 0;
+
+  if (threadCount > MAX_CHUNKS)
+    threadCount = MAX_CHUNKS;
+  step = size / threadCount;
+  if (step < MIN_CHUNK_SIZE)
+    step = MIN_CHUNK_SIZE;
+
+  // chunks start after a newline, so that columns need no fixing
+  while ((offset < size) && (chunkCount < MAX_CHUNKS)) {
+    memset(&chunks[chunkCount], 0, sizeof(Chunk));
+    chunks[chunkCount].context = createContext();
+    chunks[chunkCount].buffer = buffer;
+    chunks[chunkCount].size = size;
+    chunks[chunkCount].start = buffer + offset;
+    p = (offset + step < size) ? (char*) memchr(buffer + offset + step, '\n', size - offset - step) : NULL;
+    offset = (p == NULL) ? size : p + 1 - buffer;
+    chunks[chunkCount].limit = offset;
+    chunkCount ++;
+  }
+  if (chunkCount == 0) {
+    // an empty input still has its end of file
+    memset(&chunks[0], 0, sizeof(Chunk));
+    chunks[0].context = createContext();
+    chunks[0].buffer = buffer;
+    chunks[0].start = buffer;
+    chunkCount = 1;
+  }
+  // the end of file belongs to the last chunk
+  chunks[chunkCount - 1].limit = size + 1;
+
+  // a chunk whose thread does not start is scanned here
+  for (i = 0; i < chunkCount; i ++)
+    started[i] = (pthread_create(&threads[i], NULL, chunkWorker, &chunks[i]) == 0);
+  for (i = 0; i < chunkCount; i ++)
+    if (!started[i]) {
+      chunkWorker(&chunks[i]);
+      useContext(owner);
+    }
+  for (i = 0; i < chunkCount; i ++)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+
+  mergeChunks(owner, chunks, chunkCount);
+
+  for (i = 0; i < chunkCount; i ++) {
+    useContext(chunks[i].context);
+    freeInternPool();
+    freeContext(chunks[i].context);
+    free(chunks[i].tokens);
+    free(chunks[i].offsets);
+    free(chunks[i].errors);
+  }
+  useContext(owner);
+  owner->tokenStream.next = 0;
+  owner->tokenStream.nextError = 0;
+}
+
+void getPrescannedToken(Token *token) {
+  TokenStream *stream = &ctx->tokenStream;
+  ScanError *error;
+
+  do {
+    *token = stream->tokens[stream->next];
+    while ((stream->nextError < stream->errorCount)
+           && (stream->errors[stream->nextError].token == stream->next)) {
+      error = &stream->errors[stream->nextError ++];
+      reportError(error->errorCode, token->lineNo, token->colNo);
+    }
+    // the end of file is read again and again
+    if (stream->next < stream->count - 1)
+      stream->next ++;
+  } while (token->tokenType == TK_NONE);
+}
+
+void freeTokenStream(TokenStream *stream) {
+  free(stream->tokens);
+  free(stream->errors);
+  stream->tokens = NULL;
+  stream->errors = NULL;
+  stream->count = stream->capacity = 0;
+  stream->errorCount = stream->errorCapacity = 0;
+}
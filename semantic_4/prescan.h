@@ -0,0 +1,46 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __PRESCAN_H__
+#define __PRESCAN_H__
+
+#include "token.h"
+#include "error.h"
+
+// A scanner error, reported when the parser reaches its token
+struct ScanError_ {
+  int token;
+  ErrorCode errorCode;
+};
+
+typedef struct ScanError_ ScanError;
+
+// The whole input, scanned before parsing
+struct TokenStream_ {
+  Token *tokens;            // NULL when the parser scans as it goes
+  int count;
+  int capacity;
+  int next;                 // the token the parser reads next
+  ScanError *errors;
+  int errorCount;
+  int errorCapacity;
+  int nextError;
+};
+
+typedef struct TokenStream_ TokenStream;
+
+// Scans the context's input into its token stream. The input is cut after
+// newlines into chunks that are scanned at once on threadCount threads, each
+// as if it began outside any comment; the merge keeps a chunk's tokens from
+// the first one the previous chunk shows to start a token, or scans the
+// chunk again from there when there is none.
+void prescanInput(int threadCount);
+
+// The next token of the stream that is not TK_NONE, like getValidToken
+void getPrescannedToken(Token *token);
+void freeTokenStream(TokenStream *stream);
+
+#endif
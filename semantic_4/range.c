@@ -0,0 +1,293 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include "range.h"
+#include "error.h"
+#include "context.h"
+
+struct Interval_ {
+  long long lo, hi;
+};
+
+typedef struct Interval_ Interval;
+
+// The range of a loop variable inside its loop; the bindings of the loops
+// around a statement are chained from the innermost one
+struct Binding_ {
+  Object* variable;
+  Interval range;
+  int known;
+  struct Binding_* outer;
+};
+
+typedef struct Binding_ Binding;
+
+static Interval makeInterval(long long lo, long long hi) {
+  Interval r;
+
+  // results the VM would wrap around tell nothing
+  if ((lo < INT_MIN) || (hi > INT_MAX)) {
+    lo = INT_MIN;
+    hi = INT_MAX;
+  }
+  r.lo = lo;
+  r.hi = hi;
+  return r;
+}
+
+static Interval anyValue(void) {
+  return makeInterval(INT_MIN, INT_MAX);
+}
+
+static long long min4(long long a, long long b, long long c, long long d) {
+  long long m = (a < b) ? a : b;
+  if (c < m) m = c;
+  return (d < m) ? d : m;
+}
+
+static long long max4(long long a, long long b, long long c, long long d) {
+  long long m = (a > b) ? a : b;
+  if (c > m) m = c;
+  return (d > m) ? d : m;
+}
+
+// x op y over every pair of values; the extremes are at the corners, for
+// the division too when the divisor keeps its sign
+static Interval combine(int op, Interval x, Interval y) {
+  long long c1, c2, c3, c4;
+
+  switch (op) {
+  case SB_PLUS:
+    return makeInterval(x.lo + y.lo, x.hi + y.hi);
+  case SB_MINUS:
+    return makeInterval(x.lo - y.hi, x.hi - y.lo);
+  case SB_TIMES:
+    c1 = x.lo * y.lo; c2 = x.lo * y.hi; c3 = x.hi * y.lo; c4 = x.hi * y.hi;
+    return makeInterval(min4(c1, c2, c3, c4), max4(c1, c2, c3, c4));
+  case SB_SLASH:
+    if ((y.lo <= 0) && (y.hi >= 0))
+      return anyValue();
+    c1 = x.lo / y.lo; c2 = x.lo / y.hi; c3 = x.hi / y.lo; c4 = x.hi / y.hi;
+    return makeInterval(min4(c1, c2, c3, c4), max4(c1, c2, c3, c4));
+  default:
+    return anyValue();
+  }
+}
+
+/******************************************************************/
+
+static int isNestedIn(Scope* scope, Scope* outer) {
+  for (; scope != NULL; scope = scope->outer)
+    if (scope == outer)
+      return 1;
+  return 0;
+}
+
+static int modifies(NodeId id, Object* variable, Scope* current);
+
+// A call changes the variable when it passes the variable by reference or
+// when the subprogram is declared where the variable is visible
+static int callModifies(NodeId id, Object* variable, Scope* current) {
+  Object* obj = AST_NODE(id)->object;
+  ObjectNode* param = NULL;
+  Scope* scope = NULL;
+  Object* target;
+  NodeId arg;
+
+  if (obj->kind == OBJ_FUNCTION) {
+    param = obj->funcAttrs->paramList;
+    scope = obj->funcAttrs->scope;
+  } else if (obj->kind == OBJ_PROCEDURE) {
+    param = obj->procAttrs->paramList;
+    scope = obj->procAttrs->scope;
+  }
+  if ((scope != NULL) && isNestedIn(scope, variable->varAttrs->scope))
+    return 1;
+
+  for (arg = AST_NODE(id)->a; arg != 0; arg = AST_NODE(arg)->next) {
+    if ((param != NULL) && (param->object->paramAttrs->kind == PARAM_REFERENCE)
+        && (AST_NODE(arg)->kind == AST_VARIABLE)) {
+      target = AST_NODE(arg)->object;
+      if (target == variable)
+        return 1;
+      // a VAR parameter passed on may stand for a variable of an outer scope
+      if ((target->kind == OBJ_PARAMETER) && (target->paramAttrs->kind == PARAM_REFERENCE)
+          && (variable->varAttrs->scope != current))
+        return 1;
+    }
+    if (modifies(arg, variable, current))
+      return 1;
+    if (param != NULL)
+      param = param->next;
+  }
+  return 0;
+}
+
+// Whether running the statement or the expression may change the variable
+static int modifies(NodeId id, Object* variable, Scope* current) {
+  AstNode* node;
+  Object* target;
+  NodeId st;
+
+  if (id == 0) return 0;
+  node = AST_NODE(id);
+
+  switch (node->kind) {
+  case AST_ASSIGN:
+  case AST_FOR:
+    if (AST_NODE(node->a)->kind == AST_VARIABLE) {
+      target = AST_NODE(node->a)->object;
+      if (target == variable)
+        return 1;
+      // a VAR parameter may stand for a variable of an outer scope
+      if ((target->kind == OBJ_PARAMETER) && (target->paramAttrs->kind == PARAM_REFERENCE)
+          && (variable->varAttrs->scope != current))
+        return 1;
+    }
+    if (node->kind == AST_FOR)
+      return modifies(node->a, variable, current) || modifies(node->b, variable, current)
+        || modifies(node->c, variable, current) || modifies(node->body, variable, current);
+    return modifies(node->a, variable, current) || modifies(node->b, variable, current);
+  case AST_CALL_ST:
+  case AST_CALL:
+    return callModifies(id, variable, current);
+  case AST_BLOCK:
+    for (st = node->a; st != 0; st = AST_NODE(st)->next)
+      if (modifies(st, variable, current))
+        return 1;
+    return 0;
+  case AST_IF:
+  case AST_WHILE:
+  case AST_INDEX:
+  case AST_BINARY:
+  case AST_CONDITION:
+    return modifies(node->a, variable, current) || modifies(node->b, variable, current)
+      || modifies(node->c, variable, current);
+  case AST_NEGATE:
+    return modifies(node->a, variable, current);
+  default:
+    return 0;
+  }
+}
+
+/******************************************************************/
+
+static void checkIndex(NodeId id, Interval index) {
+  AstNode* node = AST_NODE(id);
+  int size = nodeType(node->a)->arraySize;
+
+  if ((index.lo >= 1) && (index.hi <= size))
+    node->flags |= NODE_IN_RANGE;
+  else if ((index.hi < 1) || (index.lo > size))
+    reportError(ERR_INDEX_OUT_OF_RANGE, ctx->positions[node->b].lineNo, ctx->positions[node->b].colNo);
+}
+
+// The values the expression can take; checks the indexes inside it
+static Interval rangeOf(NodeId id, Binding* env) {
+  AstNode* node = AST_NODE(id);
+  Binding* binding;
+  NodeId arg;
+  Interval x;
+
+  switch (node->kind) {
+  case AST_NUMBER:
+  case AST_CHAR:
+    return makeInterval(node->value, node->value);
+  case AST_VARIABLE:
+    for (binding = env; binding != NULL; binding = binding->outer)
+      if (binding->variable == node->object)
+        return binding->known ? binding->range : anyValue();
+    return anyValue();
+  case AST_INDEX:
+    rangeOf(node->a, env);
+    checkIndex(id, rangeOf(node->b, env));
+    return anyValue();
+  case AST_CALL:
+  case AST_CALL_ST:
+    for (arg = node->a; arg != 0; arg = AST_NODE(arg)->next)
+      rangeOf(arg, env);
+    return anyValue();
+  case AST_NEGATE:
+    x = rangeOf(node->a, env);
+    return makeInterval(- x.hi, - x.lo);
+  case AST_BINARY:
+    x = rangeOf(node->a, env);
+    return combine(node->op, x, rangeOf(node->b, env));
+  case AST_CONDITION:
+    rangeOf(node->a, env);
+    rangeOf(node->b, env);
+    return makeInterval(0, 1);
+  default:
+    return anyValue();
+  }
+}
+
+static void analyzeStatement(NodeId id, Binding* env, Scope* current) {
+  AstNode* node;
+  Binding loop;
+  Interval from, to;
+  NodeId st;
+
+  if (id == 0) return;
+  node = AST_NODE(id);
+
+  switch (node->kind) {
+  case AST_ASSIGN:
+    rangeOf(node->a, env);
+    rangeOf(node->b, env);
+    break;
+  case AST_CALL_ST:
+    rangeOf(id, env);
+    break;
+  case AST_BLOCK:
+    for (st = node->a; st != 0; st = AST_NODE(st)->next)
+      analyzeStatement(st, env, current);
+    break;
+  case AST_IF:
+    rangeOf(node->a, env);
+    analyzeStatement(node->b, env, current);
+    analyzeStatement(node->c, env, current);
+    break;
+  case AST_WHILE:
+    rangeOf(node->a, env);
+    analyzeStatement(node->b, env, current);
+    break;
+  case AST_FOR:
+    // the body runs with from <= variable <= to, where to is evaluated
+    // before every round; the binding also hides one of an outer loop
+    from = rangeOf(node->b, env);
+    to = rangeOf(node->c, env);
+    loop.variable = AST_NODE(node->a)->object;
+    loop.range = makeInterval(from.lo, to.hi);
+    loop.known = (from.lo <= to.hi) && !modifies(node->body, loop.variable, current)
+      && !modifies(node->c, loop.variable, current);
+    loop.outer = env;
+    analyzeStatement(node->body, &loop, current);
+    break;
+  default:
+    break;
+  }
+}
+
+static void analyzeScope(Scope* scope) {
+  ObjectNode* node;
+  Object* obj;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION)
+      analyzeScope(obj->funcAttrs->scope);
+    else if (obj->kind == OBJ_PROCEDURE)
+      analyzeScope(obj->procAttrs->scope);
+  }
+  analyzeStatement(scope->body, NULL, scope);
+}
+
+void analyzeRanges(Object* program) {
+  analyzeScope(program->progAttrs->scope);
+}
@@ -0,0 +1,18 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __RANGE_H__
+#define __RANGE_H__
+
+#include "symtab.h"
+
+// Interval analysis of the (folded) program. An index gets NODE_IN_RANGE
+// when every value it can take lies within the array, and is reported when
+// none does. The values known are those of literals and of the variables of
+// FOR loops whose body cannot change them.
+void analyzeRanges(Object* program);
+
+#endif
@@ -5,33 +5,167 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "reader.h"
+#include "context.h"
 
-FILE *inputStream;
-int lineNo, colNo;
-int currentChar;
+static char emptyBuffer[1];
 
 int readChar(void) {
-  currentChar = getc(inputStream);
-  colNo ++;
-  if (currentChar == '\n') {
-    lineNo ++;
-    colNo = 0;
+  ctx->currentChar = (ctx->inputPtr < ctx->inputEnd) ? (unsigned char) *(ctx->inputPtr ++) : EOF;
+  return ctx->currentChar;
+}
+
+static void addLineMark(long offset) {
+  if (ctx->lineCount == ctx->lineCapacity) {
+    ctx->lineCapacity = (ctx->lineCapacity == 0) ? 1024 : ctx->lineCapacity * 2;
+    ctx->lineMarks = (long*) realloc(ctx->lineMarks, ctx->lineCapacity * sizeof(long));
+  }
+  ctx->lineMarks[ctx->lineCount ++] = offset;
+}
+
+void locateChar(char *p, int *ln, int *cn) {
+  char *limit = (p < ctx->inputEnd) ? p + 1 : ctx->inputEnd;
+  long offset = p - ctx->inputBuffer;
+  int lo, hi, mid;
+
+  // Extend the index with the newlines up to (and including) p
+  while (ctx->indexedPtr < limit) {
+    char *nl = (char*) memchr(ctx->indexedPtr, '\n', limit - ctx->indexedPtr);
+    if (nl == NULL) {
+      ctx->indexedPtr = limit;
+      break;
+    }
+    addLineMark(nl - ctx->inputBuffer);
+    ctx->indexedPtr = nl + 1;
   }
-  return currentChar;
+
+  // Positions are mostly asked for in order, so try the last line first
+  lo = 0;
+  hi = ctx->lineCount - 1;
+  if (ctx->lineMarks[hi] <= offset)
+    lo = hi;
+  else
+    while (lo < hi) {
+      mid = (lo + hi + 1) / 2;
+      if (ctx->lineMarks[mid] <= offset) lo = mid;
+      else hi = mid - 1;
+    }
+
+  *ln = lo + 1;
+  *cn = offset - ctx->lineMarks[lo];
 }
 
+#ifdef _WIN32
+
+static int loadInput(char *fileName) {
+  FILE *f = fopen(fileName, "rb");
+  if (f == NULL)
+    return IO_ERROR;
+  fseek(f, 0, SEEK_END);
+  ctx->inputSize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (ctx->inputSize <= 0) {
+    ctx->inputSize = 0;
+    ctx->inputBuffer = emptyBuffer;
+  } else {
+    ctx->inputBuffer = (char*) malloc(ctx->inputSize + 1);
+    ctx->inputSize = fread(ctx->inputBuffer, 1, ctx->inputSize, f);
+    ctx->inputBuffer[ctx->inputSize] = '\0';
+  }
+  fclose(f);
+  return IO_SUCCESS;
+}
+
+static void unloadInput(void) {
+  if (ctx->inputBuffer != emptyBuffer)
+    free(ctx->inputBuffer);
+}
+
+#else
+
+// The file is mapped over an anonymous mapping one byte longer, so the
+// byte after it is 0 even when the file ends at a page boundary
+static int loadInput(char *fileName) {
+  struct stat st;
+  char *base;
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    return IO_ERROR;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return IO_ERROR;
+  }
+  ctx->inputSize = st.st_size;
+  if (ctx->inputSize == 0)
+    ctx->inputBuffer = emptyBuffer;
+  else {
+    base = (char*) mmap(NULL, ctx->inputSize + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      close(fd);
+      return IO_ERROR;
+    }
+    ctx->inputBuffer = (char*) mmap(base, ctx->inputSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    if (ctx->inputBuffer == MAP_FAILED) {
+      munmap(base, ctx->inputSize + 1);
+      close(fd);
+      return IO_ERROR;
+    }
+  }
+  close(fd);
+  return IO_SUCCESS;
+}
+
+static void unloadInput(void) {
+  if (ctx->inputBuffer != emptyBuffer)
+    munmap(ctx->inputBuffer, ctx->inputSize + 1);
+}
+
+#endif
+
 int openInputStream(char *fileName) {
-  inputStream = fopen(fileName, "rt");
-  if (inputStream == NULL)
+  if (loadInput(fileName) == IO_ERROR)
     return IO_ERROR;
-  lineNo = 1;
-  colNo = 0;
+  ctx->inputEnd = ctx->inputBuffer + ctx->inputSize;
+  ctx->inputPtr = ctx->inputBuffer;
+
+  ctx->lineCount = 0;
+  addLineMark(-1);
+  ctx->indexedPtr = ctx->inputBuffer;
+
   readChar();
   return IO_SUCCESS;
 }
 
 void closeInputStream() {
-  fclose(inputStream);
+  unloadInput();
+  closeInputRange();
+}
+
+int openInputRange(char *buffer, long size, char *lineStart, char *from) {
+  ctx->inputBuffer = buffer;
+  ctx->inputSize = size;
+  ctx->inputEnd = buffer + size;
+  ctx->inputPtr = from;
+
+  ctx->lineCount = 0;
+  addLineMark(lineStart - buffer - 1);
+  ctx->indexedPtr = lineStart;
+
+  readChar();
+  return IO_SUCCESS;
+}
+
+void closeInputRange(void) {
+  free(ctx->lineMarks);
+  ctx->lineMarks = NULL;
+  ctx->lineCount = ctx->lineCapacity = 0;
 }
 
@@ -10,8 +10,19 @@
 #define IO_ERROR 0
 #define IO_SUCCESS 1
 
+// The whole source file is held in one contiguous buffer of the compiler context.
+// currentChar is the character just before inputPtr (or EOF when inputPtr == inputEnd)
+// The byte at inputEnd can always be read; it is 0 and not part of the input.
+
 int readChar(void);
 int openInputStream(char *fileName);
 void closeInputStream(void);
 
+// Reads another context's input of size bytes from from on. Lines are
+// numbered from lineStart, which is the buffer or follows a '\n'.
+int openInputRange(char *buffer, long size, char *lineStart, char *from);
+void closeInputRange(void);
+
+void locateChar(char *p, int *lineNo, int *colNo);
+
 #endif
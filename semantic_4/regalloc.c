@@ -0,0 +1,336 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdlib.h>
+#include "regalloc.h"
+#include "codegen.h"
+#include "context.h"
+
+// The callee-saved registers: calls of other subprograms and of the runtime
+// keep them, so the values they hold survive the calls
+static const enum X86Register allocatable[] = {
+  X86_RBX, X86_R12, X86_R13, X86_R14, X86_R15
+};
+
+#define NUM_OF_ALLOCATABLE ((int) (sizeof(allocatable) / sizeof(allocatable[0])))
+
+// The references to an object span the positions from start to end of the
+// walk of the body, which numbers the nodes in the order they are evaluated
+struct LiveInterval_ {
+  Object* object;
+  int start, end;           // -1 when the body does not refer to it
+  int exposed;
+  int reg;
+};
+
+typedef struct LiveInterval_ LiveInterval;
+
+struct Liveness_ {
+  LiveInterval* intervals;
+  int count;
+  int position;
+  int nested;               // walking a nested subprogram
+  int* loops;               // start and end of each loop
+  int loopCount;
+  int loopCapacity;
+};
+
+typedef struct Liveness_ Liveness;
+
+static LiveInterval* intervalOf(Liveness* live, Object* obj) {
+  int i;
+
+  for (i = 0; i < live->count; i ++)
+    if (live->intervals[i].object == obj)
+      return &live->intervals[i];
+  return NULL;
+}
+
+static void touch(Liveness* live, Object* obj) {
+  LiveInterval* interval = intervalOf(live, obj);
+
+  if (interval == NULL)
+    return;
+  if (live->nested)
+    interval->exposed = 1;
+  else {
+    if (interval->start < 0)
+      interval->start = live->position;
+    interval->end = live->position;
+  }
+}
+
+static void addLoop(Liveness* live, int start, int end) {
+  if (live->loopCount == live->loopCapacity) {
+    live->loopCapacity = (live->loopCapacity == 0) ? 16 : live->loopCapacity * 2;
+    live->loops = (int*) realloc(live->loops, live->loopCapacity * 2 * sizeof(int));
+  }
+  live->loops[2 * live->loopCount] = start;
+  live->loops[2 * live->loopCount + 1] = end;
+  live->loopCount ++;
+}
+
+static void visit(Liveness* live, NodeId id);
+
+// The frame word of a variable passed by reference is written by the callee
+static void visitCall(Liveness* live, NodeId id) {
+  Object* obj = AST_NODE(id)->object;
+  ObjectNode* param = NULL;
+  LiveInterval* interval;
+  NodeId arg;
+
+  if (obj->kind == OBJ_FUNCTION)
+    param = obj->funcAttrs->paramList;
+  else if (obj->kind == OBJ_PROCEDURE)
+    param = obj->procAttrs->paramList;
+
+  for (arg = AST_NODE(id)->a; arg != 0; arg = AST_NODE(arg)->next) {
+    visit(live, arg);
+    if ((param != NULL) && (param->object->paramAttrs->kind == PARAM_REFERENCE)
+        && (AST_NODE(arg)->kind == AST_VARIABLE)) {
+      interval = intervalOf(live, AST_NODE(arg)->object);
+      if (interval != NULL)
+        interval->exposed = 1;
+    }
+    if (param != NULL)
+      param = param->next;
+  }
+}
+
+static void visit(Liveness* live, NodeId id) {
+  AstNode* node;
+  NodeId st;
+  int start;
+
+  if (id == 0) return;
+  node = AST_NODE(id);
+  live->position ++;
+
+  switch (node->kind) {
+  case AST_VARIABLE:
+    touch(live, node->object);
+    break;
+  case AST_CALL:
+  case AST_CALL_ST:
+    visitCall(live, id);
+    break;
+  case AST_BLOCK:
+    for (st = node->a; st != 0; st = AST_NODE(st)->next)
+      visit(live, st);
+    break;
+  case AST_WHILE:
+    start = live->position;
+    visit(live, node->a);
+    visit(live, node->b);
+    addLoop(live, start, live->position);
+    break;
+  case AST_FOR:
+    // the loop tests and steps the variable on every round
+    visit(live, node->a);
+    visit(live, node->b);
+    start = live->position;
+    visit(live, node->c);
+    visit(live, node->body);
+    live->position ++;
+    touch(live, AST_NODE(node->a)->object);
+    addLoop(live, start, live->position);
+    break;
+  default:
+    visit(live, node->a);
+    visit(live, node->b);
+    visit(live, node->c);
+    break;
+  }
+}
+
+static void visitNested(Liveness* live, Scope* scope) {
+  ObjectNode* node;
+  Object* obj;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_FUNCTION) {
+      visit(live, obj->funcAttrs->scope->body);
+      visitNested(live, obj->funcAttrs->scope);
+    } else if (obj->kind == OBJ_PROCEDURE) {
+      visit(live, obj->procAttrs->scope->body);
+      visitNested(live, obj->procAttrs->scope);
+    }
+  }
+}
+
+static int isReference(Object* obj) {
+  return (obj->kind == OBJ_PARAMETER) && (obj->paramAttrs->kind == PARAM_REFERENCE);
+}
+
+// A value held in a register over a loop has to be there on every round
+static void extendOverLoops(Liveness* live) {
+  LiveInterval* interval;
+  int changed = 1;
+  int i, k, start, end;
+
+  while (changed) {
+    changed = 0;
+    for (i = 0; i < live->count; i ++) {
+      interval = &live->intervals[i];
+      if (interval->start < 0)
+        continue;
+      for (k = 0; k < live->loopCount; k ++) {
+        start = live->loops[2 * k];
+        end = live->loops[2 * k + 1];
+        if ((interval->end < start) || (interval->start > end))
+          continue;
+        if (interval->start > start) {
+          interval->start = start;
+          changed = 1;
+        }
+        if (interval->end < end) {
+          interval->end = end;
+          changed = 1;
+        }
+      }
+    }
+  }
+}
+
+static int compareStarts(const void* x, const void* y) {
+  return ((const LiveInterval*) x)->start - ((const LiveInterval*) y)->start;
+}
+
+// Poletto and Sarkar's linear scan: when no register is free, the interval
+// that ends last stays in memory
+static void linearScan(LiveInterval* intervals, int count) {
+  LiveInterval* active[NUM_OF_ALLOCATABLE];
+  int isFree[NUM_OF_ALLOCATABLE];
+  LiveInterval* current;
+  int activeCount = 0;
+  int i, k, last;
+
+  for (k = 0; k < NUM_OF_ALLOCATABLE; k ++)
+    isFree[k] = 1;
+
+  for (i = 0; i < count; i ++) {
+    current = &intervals[i];
+
+    // the intervals that ended give their registers back
+    for (k = 0; k < activeCount; )
+      if (active[k]->end < current->start) {
+        isFree[active[k]->reg] = 1;
+        active[k] = active[-- activeCount];
+      } else k ++;
+
+    if (activeCount < NUM_OF_ALLOCATABLE) {
+      for (k = 0; !isFree[k]; k ++)
+        ;
+      isFree[k] = 0;
+      current->reg = k;
+      active[activeCount ++] = current;
+      continue;
+    }
+
+    last = 0;
+    for (k = 1; k < activeCount; k ++)
+      if (active[k]->end > active[last]->end)
+        last = k;
+    if (active[last]->end > current->end) {
+      current->reg = active[last]->reg;
+      active[last]->reg = -1;
+      active[last] = current;
+    } else current->reg = -1;
+  }
+}
+
+void allocateRegisters(Scope* scope, RegisterAllocation* allocation) {
+  Liveness live;
+  LiveInterval* interval;
+  ObjectNode* node;
+  Object* obj;
+  int i;
+
+  live.intervals = NULL;
+  live.count = 0;
+  live.position = 0;
+  live.nested = 0;
+  live.loops = NULL;
+  live.loopCount = live.loopCapacity = 0;
+
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (obj->kind == OBJ_VARIABLE) {
+      obj->varAttrs->nativeRegister = 0;
+      if (obj->varAttrs->type->typeClass != TP_ARRAY)
+        live.count ++;
+    } else if (obj->kind == OBJ_PARAMETER) {
+      obj->paramAttrs->nativeRegister = 0;
+      live.count ++;
+    }
+  }
+  allocation->savedRegisters = 0;
+  allocation->exposedCount = 0;
+  allocation->temps = 0;
+  if (live.count == 0)
+    return;
+
+  live.intervals = (LiveInterval*) malloc(live.count * sizeof(LiveInterval));
+  live.count = 0;
+  for (node = scope->objList; node != NULL; node = node->next) {
+    obj = node->object;
+    if (((obj->kind == OBJ_VARIABLE) && (obj->varAttrs->type->typeClass != TP_ARRAY))
+        || (obj->kind == OBJ_PARAMETER)) {
+      interval = &live.intervals[live.count ++];
+      interval->object = obj;
+      interval->start = interval->end = -1;
+      interval->exposed = 0;
+    }
+  }
+
+  visit(&live, scope->body);
+  live.nested = 1;
+  visitNested(&live, scope);
+
+  // parameters are loaded on entry; a variable the frame may change behind
+  // the body's back keeps its register over the whole body. The address a
+  // reference parameter holds never changes.
+  for (i = 0; i < live.count; i ++) {
+    interval = &live.intervals[i];
+    if (interval->start < 0)
+      continue;
+    if (isReference(interval->object))
+      interval->exposed = 0;
+    if (interval->object->kind == OBJ_PARAMETER)
+      interval->start = 0;
+    if (interval->exposed) {
+      interval->start = 0;
+      interval->end = live.position;
+    }
+  }
+  extendOverLoops(&live);
+
+  // the unreferenced ones go last and get nothing
+  for (i = 0; i < live.count; i ++)
+    if (live.intervals[i].start < 0)
+      live.intervals[i].start = live.position + 1;
+  qsort(live.intervals, live.count, sizeof(LiveInterval), compareStarts);
+  for (i = 0; (i < live.count) && (live.intervals[i].start <= live.position); i ++)
+    ;
+  linearScan(live.intervals, i);
+
+  for (; i > 0; i --) {
+    interval = &live.intervals[i - 1];
+    if (interval->reg < 0)
+      continue;
+    obj = interval->object;
+    if (obj->kind == OBJ_VARIABLE)
+      obj->varAttrs->nativeRegister = allocatable[interval->reg];
+    else obj->paramAttrs->nativeRegister = allocatable[interval->reg];
+    allocation->savedRegisters |= 1 << allocatable[interval->reg];
+    if (interval->exposed)
+      allocation->exposed[allocation->exposedCount ++] = obj;
+  }
+
+  free(live.intervals);
+  free(live.loops);
+}
@@ -0,0 +1,30 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __REGALLOC_H__
+#define __REGALLOC_H__
+
+#include "symtab.h"
+#include "x86.h"
+
+// Registers of the native code of one subprogram
+struct RegisterAllocation_ {
+  int savedRegisters;                       // callee-saved registers it uses, a bit each
+  // variables in registers that nested subprograms or reference parameters
+  // may reach through the frame; stored before each call and reloaded after
+  Object* exposed[NUM_OF_X86_REGISTERS];
+  int exposedCount;
+  int temps;                                // temporaries held by the code being generated
+};
+
+typedef struct RegisterAllocation_ RegisterAllocation;
+
+// Gives the integer and character variables and the parameters of the scope
+// registers, by linear scan over the live intervals of their references in
+// the body; sets their nativeRegister
+void allocateRegisters(Scope* scope, RegisterAllocation* allocation);
+
+#endif
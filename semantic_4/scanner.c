@@ -6,241 +6,404 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#if defined(__SSE2__) && defined(__GNUC__)
+#define HAVE_SSE2_SKIP
+#include <emmintrin.h>
+#endif
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define HAVE_SWAR_DIGITS
+#endif
 
 #include "reader.h"
 #include "charcode.h"
 #include "token.h"
 #include "error.h"
 #include "scanner.h"
+#include "intern.h"
+#include "context.h"
 
 
-extern int lineNo;
-extern int colNo;
-extern int currentChar;
-
-extern CharCode charCodes[];
-
 /***************************************************************/
 
-void skipBlank() {
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_SPACE))
-    readChar();
-}
-
-void skipComment() {
-  int state = 0;
-  while ((currentChar != EOF) && (state < 2)) {
-    switch (charCodes[currentChar]) {
-    case CHAR_TIMES:
-      state = 1;
-      break;
-    case CHAR_RPAR:
-      if (state == 1) state = 2;
-      else state = 0;
-      break;
-    default:
-      state = 0;
-    }
-    readChar();
+#define CHAR_CLASSES (CHAR_EOF + 1)
+
+// Scanner states. Consuming a character moves to the next state;
+// ST_DONE means the token ends before the current character.
+typedef enum {
+  ST_START,
+  ST_IDENT,
+  ST_NUMBER,
+  ST_PLUS,
+  ST_MINUS,
+  ST_TIMES,
+  ST_SLASH,
+  ST_LT,
+  ST_LE,
+  ST_GT,
+  ST_GE,
+  ST_EQ,
+  ST_EXCLAIMATION,
+  ST_NEQ,
+  ST_COMMA,
+  ST_PERIOD,
+  ST_RSEL,
+  ST_COLON,
+  ST_ASSIGN,
+  ST_SEMICOLON,
+  ST_LPAR,
+  ST_LSEL,
+  ST_RPAR,
+  ST_COMMENT,
+  ST_COMMENT_STAR,
+  ST_QUOTE,
+  ST_CHAR,
+  ST_CHAR_END,
+  ST_UNKNOWN,
+  ST_DONE
+} ScannerState;
+
+// transitions[state][charCode]
+static const unsigned char transitions[ST_DONE][CHAR_CLASSES] = {
+  /* ST_START */
+  {ST_START,        ST_IDENT,        ST_NUMBER,       ST_PLUS,         ST_MINUS,
+   ST_TIMES,        ST_SLASH,        ST_LT,           ST_GT,           ST_EXCLAIMATION,
+   ST_EQ,           ST_COMMA,        ST_PERIOD,       ST_COLON,        ST_SEMICOLON,
+   ST_QUOTE,        ST_LPAR,         ST_RPAR,         ST_UNKNOWN,      ST_DONE},
+  /* ST_IDENT */
+  {ST_DONE,         ST_IDENT,        ST_IDENT,        ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_NUMBER */
+  {ST_DONE,         ST_DONE,         ST_NUMBER,       ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_PLUS */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_MINUS */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_TIMES */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_SLASH */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_LT */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_LE,           ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_LE */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_GT */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_GE,           ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_GE */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_EQ */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_EXCLAIMATION */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_NEQ,          ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_NEQ */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_COMMA */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_PERIOD */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_RSEL,         ST_DONE,         ST_DONE},
+  /* ST_RSEL */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_COLON */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_ASSIGN,       ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_ASSIGN */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_SEMICOLON */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_LPAR */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_COMMENT,      ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_LSEL,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_LSEL */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_RPAR */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_COMMENT */
+  {ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,
+   ST_COMMENT_STAR, ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,
+   ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,
+   ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_DONE},
+  /* ST_COMMENT_STAR */
+  {ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,
+   ST_COMMENT_STAR, ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,
+   ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,      ST_COMMENT,
+   ST_COMMENT,      ST_COMMENT,      ST_START,        ST_COMMENT,      ST_DONE},
+  /* ST_QUOTE */
+  {ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,
+   ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,
+   ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,
+   ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_CHAR,         ST_DONE},
+  /* ST_CHAR */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_CHAR_END,     ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_CHAR_END */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE},
+  /* ST_UNKNOWN */
+  {ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,
+   ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE,         ST_DONE}
+
+};
+
+// Token produced when the scanner stops in a state
+static const TokenType acceptTokens[ST_DONE] = {
+  TK_EOF,        // ST_START
+  TK_IDENT,      // ST_IDENT
+  TK_NUMBER,     // ST_NUMBER
+  SB_PLUS,       // ST_PLUS
+  SB_MINUS,      // ST_MINUS
+  SB_TIMES,      // ST_TIMES
+  SB_SLASH,      // ST_SLASH
+  SB_LT,         // ST_LT
+  SB_LE,         // ST_LE
+  SB_GT,         // ST_GT
+  SB_GE,         // ST_GE
+  SB_EQ,         // ST_EQ
+  TK_NONE,       // ST_EXCLAIMATION
+  SB_NEQ,        // ST_NEQ
+  SB_COMMA,      // ST_COMMA
+  SB_PERIOD,     // ST_PERIOD
+  SB_RSEL,       // ST_RSEL
+  SB_COLON,      // ST_COLON
+  SB_ASSIGN,     // ST_ASSIGN
+  SB_SEMICOLON,  // ST_SEMICOLON
+  SB_LPAR,       // ST_LPAR
+  SB_LSEL,       // ST_LSEL
+  SB_RPAR,       // ST_RPAR
+  TK_EOF,        // ST_COMMENT
+  TK_EOF,        // ST_COMMENT_STAR
+  TK_NONE,       // ST_QUOTE
+  TK_NONE,       // ST_CHAR
+  TK_CHAR,       // ST_CHAR_END
+  TK_NONE        // ST_UNKNOWN
+};
+
+// Blanks between tokens and the text of comments are most of a source file,
+// so they are skipped a block of 16 bytes at a time. Line numbers need no
+// counting here: locateChar finds the newlines when a position is asked for.
+
+// The first byte at or after p that is not a blank (9-13 or 32)
+static char* skipBlanks(char *p, char *end) {
+#ifdef HAVE_SSE2_SKIP
+  __m128i v, t;
+  int mask;
+
+  if ((p < end) && (CHAR_CODE((unsigned char) *p) != CHAR_SPACE))
+    return p;
+  for (; end - p >= 16; p += 16) {
+    v = _mm_loadu_si128((const __m128i*) p);
+    t = _mm_sub_epi8(v, _mm_set1_epi8(9));
+    mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                          _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t)));
+    if (mask != 0xFFFF)
+      return p + __builtin_ctz(~mask);
   }
-  if (state != 2) 
-    error(ERR_END_OF_COMMENT, lineNo, colNo);
+#endif
+  while ((p < end) && (CHAR_CODE((unsigned char) *p) == CHAR_SPACE))
+    p ++;
+  return p;
 }
 
-Token* readIdentKeyword(void) {
-  Token *token = makeToken(TK_NONE, lineNo, colNo);
-  int count = 1;
-
-  token->string[0] = toupper((char)currentChar);
-  readChar();
-
-  while ((currentChar != EOF) && 
-	 ((charCodes[currentChar] == CHAR_LETTER) || (charCodes[currentChar] == CHAR_DIGIT))) {
-    if (count <= MAX_IDENT_LEN) token->string[count++] = toupper((char)currentChar);
-    readChar();
-  }
+// The first '*' at or after p in the text of a comment
+static char* skipCommentText(char *p, char *end) {
+#ifdef HAVE_SSE2_SKIP
+  int mask;
 
-  if (count > MAX_IDENT_LEN) {
-    error(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
-    return token;
+  for (; end - p >= 16; p += 16) {
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) p), _mm_set1_epi8('*')));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
   }
+#endif
+  while ((p < end) && (*p != '*'))
+    p ++;
+  return p;
+}
 
-  token->string[count] = '\0';
-  token->tokenType = checkKeyword(token->string);
-
-  if (token->tokenType == TK_NONE)
-    token->tokenType = TK_IDENT;
+// The value of the 8 digits at p: the pairs, then the quads, then the
+// halves are combined by multiplications on the whole 64-bit word
+static uint64_t eightDigits(const char *p) {
+  uint64_t v;
 
-  return token;
+  memcpy(&v, p, 8);
+  v -= 0x3030303030303030ULL;
+  v = (v * 10) + (v >> 8);
+  return (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+          + (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
 }
 
-Token* readNumber(void) {
-  Token *token = makeToken(TK_NUMBER, lineNo, colNo);
-  int count = 0;
+// The value of the count digits at p, or -1 when it is above INT_MAX
+static int readNumber(const char *p, int count) {
+  uint64_t value = 0;
 
-  while ((currentChar != EOF) && (charCodes[currentChar] == CHAR_DIGIT)) {
-    token->string[count++] = (char)currentChar;
-    readChar();
+  while ((count > 0) && (*p == '0')) {
+    p ++;
+    count --;
   }
-
-  token->string[count] = '\0';
-  token->value = atoi(token->string);
-  return token;
+  // INT_MAX has 10 digits
+  if (count > 10)
+    return -1;
+#ifdef HAVE_SWAR_DIGITS
+  if (count >= 8) {
+    value = eightDigits(p);
+    p += 8;
+    count -= 8;
+  }
+#endif
+  for (; count > 0; count --)
+    value = value * 10 + (*p ++ - '0');
+  return (value > INT_MAX) ? -1 : (int) value;
 }
 
-Token* readConstChar(void) {
-  Token *token = makeToken(TK_CHAR, lineNo, colNo);
-
-  readChar();
-  if (currentChar == EOF) {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
+void getToken(Token *token) {
+  char *end = ctx->inputEnd;
+  char *p = (ctx->currentChar == EOF) ? end : ctx->inputPtr - 1;
+  char *start = p;
+  int state = ST_START;
+  int next, count, i;
+
+  for (;;) {
+    // at end the index is masked to 0, the entry of EOF
+    next = transitions[state][charCodes[-(p < end) & ((unsigned char) *p + 1)]];
+    if (next == ST_DONE) break;
+    if (state == ST_START) start = p;
+    state = next;
+    p ++;
+    if (state == ST_START)
+      p = skipBlanks(p, end);
+    else if (state == ST_COMMENT)
+      p = skipCommentText(p, end);
   }
-    
-  token->string[0] = currentChar;
-  token->string[1] = '\0';
 
+  ctx->inputPtr = p;
   readChar();
-  if (currentChar == EOF) {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
-  }
 
-  if (charCodes[currentChar] == CHAR_SINGLEQUOTE) {
-    readChar();
-    return token;
-  } else {
-    token->tokenType = TK_NONE;
-    error(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
-    return token;
-  }
-}
-
-Token* getToken(void) {
-  Token *token;
-  int ln, cn;
-
-  if (currentChar == EOF) 
-    return makeToken(TK_EOF, lineNo, colNo);
-
-  switch (charCodes[currentChar]) {
-  case CHAR_SPACE: skipBlank(); return getToken();
-  case CHAR_LETTER: return readIdentKeyword();
-  case CHAR_DIGIT: return readNumber();
-  case CHAR_PLUS: 
-    token = makeToken(SB_PLUS, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_MINUS:
-    token = makeToken(SB_MINUS, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_TIMES:
-    token = makeToken(SB_TIMES, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_SLASH:
-    token = makeToken(SB_SLASH, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_LT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_LE, ln, cn);
-    } else return makeToken(SB_LT, ln, cn);
-  case CHAR_GT:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_GE, ln, cn);
-    } else return makeToken(SB_GT, ln, cn);
-  case CHAR_EQ: 
-    token = makeToken(SB_EQ, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_EXCLAIMATION:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_NEQ, ln, cn);
-    } else {
-      token = makeToken(TK_NONE, ln, cn);
-      error(ERR_INVALID_SYMBOL, ln, cn);
-      return token;
+  if ((state == ST_START) || (state == ST_COMMENT) || (state == ST_COMMENT_STAR))
+    start = end;
+  locateChar(start, &token->lineNo, &token->colNo);
+  token->tokenType = acceptTokens[state];
+
+  switch (state) {
+  case ST_IDENT:
+    count = p - start;
+    if (count > MAX_IDENT_LEN) {
+      token->tokenType = TK_NONE;
+      reportError(ERR_IDENT_TOO_LONG, token->lineNo, token->colNo);
+      break;
+    }
+    for (i = 0; i < count; i ++)
+      token->string[i] = toupper(start[i]);
+    token->string[count] = '\0';
+    token->tokenType = checkKeyword(token->string);
+    if (token->tokenType == TK_NONE) {
+      token->tokenType = TK_IDENT;
+      token->ident = internString(token->string, count);
     }
-  case CHAR_COMMA:
-    token = makeToken(SB_COMMA, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_PERIOD:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_RPAR)) {
-      readChar();
-      return makeToken(SB_RSEL, ln, cn);
-    } else return makeToken(SB_PERIOD, ln, cn);
-  case CHAR_SEMICOLON:
-    token = makeToken(SB_SEMICOLON, lineNo, colNo);
-    readChar(); 
-    return token;
-  case CHAR_COLON:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-    if ((currentChar != EOF) && (charCodes[currentChar] == CHAR_EQ)) {
-      readChar();
-      return makeToken(SB_ASSIGN, ln, cn);
-    } else return makeToken(SB_COLON, ln, cn);
-  case CHAR_SINGLEQUOTE: return readConstChar();
-  case CHAR_LPAR:
-    ln = lineNo;
-    cn = colNo;
-    readChar();
-
-    if (currentChar == EOF) 
-      return makeToken(SB_LPAR, ln, cn);
-
-    switch (charCodes[currentChar]) {
-    case CHAR_PERIOD:
-      readChar();
-      return makeToken(SB_LSEL, ln, cn);
-    case CHAR_TIMES:
-      readChar();
-      skipComment();
-      return getToken();
-    default:
-      return makeToken(SB_LPAR, ln, cn);
+    break;
+  case ST_NUMBER:
+    token->value = readNumber(start, p - start);
+    if (token->value < 0) {
+      // still a number, so that parsing goes on as usual
+      token->value = 0;
+      reportError(ERR_NUMBER_TOO_LARGE, token->lineNo, token->colNo);
     }
-  case CHAR_RPAR:
-    token = makeToken(SB_RPAR, lineNo, colNo);
-    readChar(); 
-    return token;
+    break;
+  case ST_CHAR_END:
+    token->string[0] = start[1];
+    token->string[1] = '\0';
+    break;
+  case ST_COMMENT:
+  case ST_COMMENT_STAR:
+    reportError(ERR_END_OF_COMMENT, token->lineNo, token->colNo);
+    break;
+  case ST_EXCLAIMATION:
+  case ST_UNKNOWN:
+    reportError(ERR_INVALID_SYMBOL, token->lineNo, token->colNo);
+    break;
+  case ST_QUOTE:
+  case ST_CHAR:
+    reportError(ERR_INVALID_CONSTANT_CHAR, token->lineNo, token->colNo);
+    break;
   default:
-    token = makeToken(TK_NONE, lineNo, colNo);
-    error(ERR_INVALID_SYMBOL, lineNo, colNo);
-    readChar(); 
-    return token;
+    break;
   }
 }
 
-Token* getValidToken(void) {
-  Token *token = getToken();
-  while (token->tokenType == TK_NONE) {
-    free(token);
-    token = getToken();
-  }
-  return token;
+void getValidToken(Token *token) {
+  do {
+    getToken(token);
+  } while (token->tokenType == TK_NONE);
 }
 
 
@@ -252,8 +415,8 @@ void printToken(Token *token) {
 
   switch (token->tokenType) {
   case TK_NONE: printf("TK_NONE\n"); break;
-  case TK_IDENT: printf("TK_IDENT(%s)\n", token->string); break;
-  case TK_NUMBER: printf("TK_NUMBER(%s)\n", token->string); break;
+  case TK_IDENT: printf("TK_IDENT(%s)\n", token->ident); break;
+  case TK_NUMBER: printf("TK_NUMBER(%d)\n", token->value); break;
   case TK_CHAR: printf("TK_CHAR(\'%s\')\n", token->string); break;
   case TK_EOF: printf("TK_EOF\n"); break;
 
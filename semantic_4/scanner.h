@@ -9,8 +9,8 @@
 
 #include "token.h"
 
-Token* getToken(void);
-Token* getValidToken(void);
+void getToken(Token *token);
+void getValidToken(Token *token);
 void printToken(Token *token);
 
 #endif
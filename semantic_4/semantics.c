@@ -8,33 +8,32 @@
 #include <string.h>
 #include "semantics.h"
 #include "error.h"
+#include "context.h"
 
-extern SymTab* symtab;
-extern Token* currentToken;
 
 Object* lookupObject(char *name) {
-  Scope* scope = symtab->currentScope;
+  Scope* scope = ctx->symtab->currentScope;
   Object* obj;
 
   while (scope != NULL) {
-    obj = findObject(scope->objList, name);
+    obj = findScopeObject(scope, name);
     if (obj != NULL) return obj;
     scope = scope->outer;
   }
-  obj = findObject(symtab->globalObjectList, name);
+  obj = findObject(ctx->symtab->globalObjectList, name);
   if (obj != NULL) return obj;
   return NULL;
 }
 
 void checkFreshIdent(char *name) {
-  if (findObject(symtab->currentScope->objList, name) != NULL)
-    error(ERR_DUPLICATE_IDENT, currentToken->lineNo, currentToken->colNo);
+  if (findScopeObject(ctx->symtab->currentScope, name) != NULL)
+    error(ERR_DUPLICATE_IDENT, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 }
 
 Object* checkDeclaredIdent(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL) {
-    error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_IDENT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   }
   return obj;
 }
@@ -42,9 +41,9 @@ Object* checkDeclaredIdent(char* name) {
 Object* checkDeclaredConstant(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL)
-    error(ERR_UNDECLARED_CONSTANT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_CONSTANT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   if (obj->kind != OBJ_CONSTANT)
-    error(ERR_INVALID_CONSTANT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_CONSTANT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
   return obj;
 }
@@ -52,9 +51,9 @@ Object* checkDeclaredConstant(char* name) {
 Object* checkDeclaredType(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL)
-    error(ERR_UNDECLARED_TYPE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_TYPE,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   if (obj->kind != OBJ_TYPE)
-    error(ERR_INVALID_TYPE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_TYPE,ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
   return obj;
 }
@@ -62,9 +61,9 @@ Object* checkDeclaredType(char* name) {
 Object* checkDeclaredVariable(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL)
-    error(ERR_UNDECLARED_VARIABLE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_VARIABLE,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   if (obj->kind != OBJ_VARIABLE)
-    error(ERR_INVALID_VARIABLE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_VARIABLE,ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
   return obj;
 }
@@ -72,9 +71,9 @@ Object* checkDeclaredVariable(char* name) {
 Object* checkDeclaredFunction(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL)
-    error(ERR_UNDECLARED_FUNCTION,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_FUNCTION,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   if (obj->kind != OBJ_FUNCTION)
-    error(ERR_INVALID_FUNCTION,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_FUNCTION,ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
   return obj;
 }
@@ -82,9 +81,9 @@ Object* checkDeclaredFunction(char* name) {
 Object* checkDeclaredProcedure(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL)
-    error(ERR_UNDECLARED_PROCEDURE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_PROCEDURE,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   if (obj->kind != OBJ_PROCEDURE)
-    error(ERR_INVALID_PROCEDURE,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_PROCEDURE,ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
   return obj;
 }
@@ -92,18 +91,18 @@ Object* checkDeclaredProcedure(char* name) {
 Object* checkDeclaredLValueIdent(char* name) {
   Object* obj = lookupObject(name);
   if (obj == NULL)
-    error(ERR_UNDECLARED_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_UNDECLARED_IDENT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
 
   switch (obj->kind) {
   case OBJ_VARIABLE:
   case OBJ_PARAMETER:
     break;
   case OBJ_FUNCTION:
-    if (obj != symtab->currentScope->owner) 
-      error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
+    if (obj != ctx->symtab->currentScope->owner) 
+      error(ERR_INVALID_IDENT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
     break;
   default:
-    error(ERR_INVALID_IDENT,currentToken->lineNo, currentToken->colNo);
+    error(ERR_INVALID_IDENT,ctx->currentToken->lineNo, ctx->currentToken->colNo);
   }
 
   return obj;
@@ -112,32 +111,28 @@ Object* checkDeclaredLValueIdent(char* name) {
 
 void checkIntType(Type* type) {
   if (type->typeClass != TP_INT)
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 }
 
 void checkCharType(Type* type) {
   if (type->typeClass != TP_CHAR)
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 }
 
 void checkBasicType(Type* type) {
   if (type->typeClass != TP_INT && type->typeClass != TP_CHAR)
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 }
 
 void checkArrayType(Type* type) {
   if (type->typeClass != TP_ARRAY)
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
+    error(ERR_TYPE_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 }
 
 void checkTypeEquality(Type* type1, Type* type2) {
-  if (type1->typeClass != type2->typeClass) {
-    error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-  } else if (type1->typeClass == TP_ARRAY) {
-    checkTypeEquality(type1->elementType, type2->elementType);
-    if (type1->arraySize != type2->arraySize)
-      error(ERR_TYPE_INCONSISTENCY, currentToken->lineNo, currentToken->colNo);
-  }
+  // types are hash-consed, so equal types are the same object
+  if (type1 != type2)
+    error(ERR_TYPE_INCONSISTENCY, ctx->currentToken->lineNo, ctx->currentToken->colNo);
 }
 
 
@@ -9,89 +9,110 @@
 #include <string.h>
 #include "symtab.h"
 #include "error.h"
+#include "intern.h"
+#include "arena.h"
+#include "context.h"
 
-void freeObject(Object* obj);
-void freeScope(Scope* scope);
-void freeObjectList(ObjectNode *objList);
-void freeReferenceList(ObjectNode *objList);
-
-SymTab* symtab;
-Type* intType;
-Type* charType;
+// Types are hash-consed: each structurally distinct type exists exactly
+// once, so types are shared, compared by pointer and never modified.
 
 /******************* Type utilities ******************************/
 
 Type* makeIntType(void) {
-  Type* type = (Type*) malloc(sizeof(Type));
-  type->typeClass = TP_INT;
-  return type;
+  return ctx->intType;
 }
 
 Type* makeCharType(void) {
-  Type* type = (Type*) malloc(sizeof(Type));
-  type->typeClass = TP_CHAR;
+  return ctx->charType;
+}
+
+Type* makeBasicType(enum TypeClass typeClass) {
+  Type* type = (Type*) arenaAlloc(&ctx->symtabArena, sizeof(Type));
+  type->typeClass = typeClass;
+  type->arraySize = 0;
+  type->elementType = NULL;
   return type;
 }
 
+unsigned int hashArrayType(int arraySize, Type* elementType, int size) {
+  unsigned int h = (unsigned int) ((size_t) elementType >> 4) * 2654435761u;
+  return (h ^ ((unsigned int) arraySize * 40503u)) & (size - 1);
+}
+
+void growArrayTypes(void) {
+  Type** oldTypes = ctx->arrayTypes;
+  int oldSize = ctx->arrayTypesSize;
+  unsigned int h;
+  int i;
+
+  ctx->arrayTypesSize = (oldSize == 0) ? 64 : oldSize * 2;
+  ctx->arrayTypes = (Type**) arenaAlloc(&ctx->symtabArena, ctx->arrayTypesSize * sizeof(Type*));
+  memset(ctx->arrayTypes, 0, ctx->arrayTypesSize * sizeof(Type*));
+  for (i = 0; i < oldSize; i ++)
+    if (oldTypes[i] != NULL) {
+      h = hashArrayType(oldTypes[i]->arraySize, oldTypes[i]->elementType, ctx->arrayTypesSize);
+      while (ctx->arrayTypes[h] != NULL)
+        h = (h + 1) & (ctx->arrayTypesSize - 1);
+      ctx->arrayTypes[h] = oldTypes[i];
+    }
+}
+
 Type* makeArrayType(int arraySize, Type* elementType) {
-  Type* type = (Type*) malloc(sizeof(Type));
-  type->typeClass = TP_ARRAY;
+  Type* type;
+  unsigned int h;
+
+  if (2 * (ctx->arrayTypesCount + 1) > ctx->arrayTypesSize)
+    growArrayTypes();
+
+  // element types are already unique, so (size, element) identifies the array type
+  h = hashArrayType(arraySize, elementType, ctx->arrayTypesSize);
+  while ((type = ctx->arrayTypes[h]) != NULL) {
+    if ((type->arraySize == arraySize) && (type->elementType == elementType))
+      return type;
+    h = (h + 1) & (ctx->arrayTypesSize - 1);
+  }
+
+  type = makeBasicType(TP_ARRAY);
   type->arraySize = arraySize;
   type->elementType = elementType;
+  ctx->arrayTypes[h] = type;
+  ctx->arrayTypesCount ++;
   return type;
 }
 
 Type* duplicateType(Type* type) {
-  Type* resultType = (Type*) malloc(sizeof(Type));
-  resultType->typeClass = type->typeClass;
-  if (type->typeClass == TP_ARRAY) {
-    resultType->arraySize = type->arraySize;
-    resultType->elementType = duplicateType(type->elementType);
-  }
-  return resultType;
+  return type;
 }
 
 int compareType(Type* type1, Type* type2) {
-  if (type1->typeClass == type2->typeClass) {
-    if (type1->typeClass == TP_ARRAY) {
-      if (type1->arraySize == type2->arraySize)
-	return compareType(type1->elementType, type2->elementType);
-      else return 0;
-    } else return 1;
-  } else return 0;
-}
-
-void freeType(Type* type) {
-  switch (type->typeClass) {
-  case TP_INT:
-  case TP_CHAR:
-    free(type);
-    break;
-  case TP_ARRAY:
-    freeType(type->elementType);
-    freeType(type);
-    break;
-  }
+  return type1 == type2;
+}
+
+// Size in words
+int sizeOfType(Type* type) {
+  if (type->typeClass == TP_ARRAY)
+    return type->arraySize * sizeOfType(type->elementType);
+  return 1;
 }
 
 /******************* Constant utility ******************************/
 
 ConstantValue* makeIntConstant(int i) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) arenaAlloc(&ctx->symtabArena, sizeof(ConstantValue));
   value->type = TP_INT;
   value->intValue = i;
   return value;
 }
 
 ConstantValue* makeCharConstant(char ch) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) arenaAlloc(&ctx->symtabArena, sizeof(ConstantValue));
   value->type = TP_CHAR;
   value->charValue = ch;
   return value;
 }
 
 ConstantValue* duplicateConstantValue(ConstantValue* v) {
-  ConstantValue* value = (ConstantValue*) malloc(sizeof(ConstantValue));
+  ConstantValue* value = (ConstantValue*) arenaAlloc(&ctx->symtabArena, sizeof(ConstantValue));
   value->type = v->type;
   if (v->type == TP_INT) 
     value->intValue = v->intValue;
@@ -103,143 +124,89 @@ ConstantValue* duplicateConstantValue(ConstantValue* v) {
 /******************* Object utilities ******************************/
 
 Scope* createScope(Object* owner, Scope* outer) {
-  Scope* scope = (Scope*) malloc(sizeof(Scope));
+  Scope* scope = (Scope*) arenaAlloc(&ctx->symtabArena, sizeof(Scope));
   scope->objList = NULL;
+  scope->objTail = NULL;
+  scope->index = NULL;
+  scope->indexSize = 0;
+  scope->objCount = 0;
   scope->owner = owner;
   scope->outer = outer;
+  scope->body = 0;
+  scope->level = (outer == NULL) ? 0 : outer->level + 1;
+  scope->frameSize = 0;
   return scope;
 }
 
 Object* createProgramObject(char *programName) {
-  Object* program = (Object*) malloc(sizeof(Object));
-  strcpy(program->name, programName);
+  Object* program = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  program->name = programName;
   program->kind = OBJ_PROGRAM;
-  program->progAttrs = (ProgramAttributes*) malloc(sizeof(ProgramAttributes));
+  program->progAttrs = (ProgramAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(ProgramAttributes));
   program->progAttrs->scope = createScope(program,NULL);
-  symtab->program = program;
+  ctx->symtab->program = program;
 
   return program;
 }
 
 Object* createConstantObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  Object* obj = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  obj->name = name;
   obj->kind = OBJ_CONSTANT;
-  obj->constAttrs = (ConstantAttributes*) malloc(sizeof(ConstantAttributes));
+  obj->constAttrs = (ConstantAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(ConstantAttributes));
   return obj;
 }
 
 Object* createTypeObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  Object* obj = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  obj->name = name;
   obj->kind = OBJ_TYPE;
-  obj->typeAttrs = (TypeAttributes*) malloc(sizeof(TypeAttributes));
+  obj->typeAttrs = (TypeAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(TypeAttributes));
   return obj;
 }
 
 Object* createVariableObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  Object* obj = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  obj->name = name;
   obj->kind = OBJ_VARIABLE;
-  obj->varAttrs = (VariableAttributes*) malloc(sizeof(VariableAttributes));
-  obj->varAttrs->scope = symtab->currentScope;
+  obj->varAttrs = (VariableAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(VariableAttributes));
+  obj->varAttrs->scope = ctx->symtab->currentScope;
   return obj;
 }
 
 Object* createFunctionObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  Object* obj = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  obj->name = name;
   obj->kind = OBJ_FUNCTION;
-  obj->funcAttrs = (FunctionAttributes*) malloc(sizeof(FunctionAttributes));
+  obj->funcAttrs = (FunctionAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(FunctionAttributes));
   obj->funcAttrs->paramList = NULL;
-  obj->funcAttrs->scope = createScope(obj, symtab->currentScope);
+  obj->funcAttrs->returnType = NULL;
+  obj->funcAttrs->scope = createScope(obj, ctx->symtab->currentScope);
   return obj;
 }
 
 Object* createProcedureObject(char *name) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  Object* obj = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  obj->name = name;
   obj->kind = OBJ_PROCEDURE;
-  obj->procAttrs = (ProcedureAttributes*) malloc(sizeof(ProcedureAttributes));
+  obj->procAttrs = (ProcedureAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(ProcedureAttributes));
   obj->procAttrs->paramList = NULL;
-  obj->procAttrs->scope = createScope(obj, symtab->currentScope);
+  obj->procAttrs->scope = createScope(obj, ctx->symtab->currentScope);
   return obj;
 }
 
 Object* createParameterObject(char *name, enum ParamKind kind, Object* owner) {
-  Object* obj = (Object*) malloc(sizeof(Object));
-  strcpy(obj->name, name);
+  Object* obj = (Object*) arenaAlloc(&ctx->symtabArena, sizeof(Object));
+  obj->name = name;
   obj->kind = OBJ_PARAMETER;
-  obj->paramAttrs = (ParameterAttributes*) malloc(sizeof(ParameterAttributes));
+  obj->paramAttrs = (ParameterAttributes*) arenaAlloc(&ctx->symtabArena, sizeof(ParameterAttributes));
   obj->paramAttrs->kind = kind;
   obj->paramAttrs->function = owner;
   return obj;
 }
 
-void freeObject(Object* obj) {
-  switch (obj->kind) {
-  case OBJ_CONSTANT:
-    free(obj->constAttrs->value);
-    free(obj->constAttrs);
-    break;
-  case OBJ_TYPE:
-    free(obj->typeAttrs->actualType);
-    free(obj->typeAttrs);
-    break;
-  case OBJ_VARIABLE:
-    free(obj->varAttrs->type);
-    free(obj->varAttrs);
-    break;
-  case OBJ_FUNCTION:
-    freeReferenceList(obj->funcAttrs->paramList);
-    freeType(obj->funcAttrs->returnType);
-    freeScope(obj->funcAttrs->scope);
-    free(obj->funcAttrs);
-    break;
-  case OBJ_PROCEDURE:
-    freeReferenceList(obj->procAttrs->paramList);
-    freeScope(obj->procAttrs->scope);
-    free(obj->procAttrs);
-    break;
-  case OBJ_PROGRAM:
-    freeScope(obj->progAttrs->scope);
-    free(obj->progAttrs);
-    break;
-  case OBJ_PARAMETER:
-    freeType(obj->paramAttrs->type);
-    free(obj->paramAttrs);
-  }
-  free(obj);
-}
-
-void freeScope(Scope* scope) {
-  freeObjectList(scope->objList);
-  free(scope);
-}
-
-void freeObjectList(ObjectNode *objList) {
-  ObjectNode* list = objList;
-
-  while (list != NULL) {
-    ObjectNode* node = list;
-    list = list->next;
-    freeObject(node->object);
-    free(node);
-  }
-}
-
-void freeReferenceList(ObjectNode *objList) {
-  ObjectNode* list = objList;
-
-  while (list != NULL) {
-    ObjectNode* node = list;
-    list = list->next;
-    free(node);
-  }
-}
-
 void addObject(ObjectNode **objList, Object* obj) {
-  ObjectNode* node = (ObjectNode*) malloc(sizeof(ObjectNode));
+  ObjectNode* node = (ObjectNode*) arenaAlloc(&ctx->symtabArena, sizeof(ObjectNode));
   node->object = obj;
   node->next = NULL;
   if ((*objList) == NULL) 
@@ -254,68 +221,126 @@ void addObject(ObjectNode **objList, Object* obj) {
 
 Object* findObject(ObjectNode *objList, char *name) {
   while (objList != NULL) {
-    if (strcmp(objList->object->name, name) == 0) 
+    if (objList->object->name == name) 
       return objList->object;
     else objList = objList->next;
   }
   return NULL;
 }
 
+unsigned int hashName(char *name, int indexSize) {
+  // names are interned, so the address identifies the name
+  return ((unsigned int) ((size_t) name >> 3) * 2654435761u) & (indexSize - 1);
+}
+
+void indexObject(Scope* scope, Object* obj) {
+  unsigned int h = hashName(obj->name, scope->indexSize);
+  while (scope->index[h] != NULL) {
+    // keep the first declaration of a name, as the list search would
+    if (scope->index[h]->name == obj->name) return;
+    h = (h + 1) & (scope->indexSize - 1);
+  }
+  scope->index[h] = obj;
+}
+
+void growScopeIndex(Scope* scope) {
+  ObjectNode* node;
+
+  scope->indexSize = (scope->indexSize == 0) ? 8 : scope->indexSize * 2;
+  scope->index = (Object**) arenaAlloc(&ctx->symtabArena, scope->indexSize * sizeof(Object*));
+  memset(scope->index, 0, scope->indexSize * sizeof(Object*));
+  for (node = scope->objList; node != NULL; node = node->next)
+    indexObject(scope, node->object);
+}
+
+void addScopeObject(Scope* scope, Object* obj) {
+  ObjectNode* node = (ObjectNode*) arenaAlloc(&ctx->symtabArena, sizeof(ObjectNode));
+  node->object = obj;
+  node->next = NULL;
+  if (scope->objTail == NULL)
+    scope->objList = node;
+  else scope->objTail->next = node;
+  scope->objTail = node;
+  scope->objCount ++;
+
+  if (2 * scope->objCount > scope->indexSize)
+    growScopeIndex(scope);
+  else indexObject(scope, obj);
+}
+
+Object* findScopeObject(Scope *scope, char *name) {
+  unsigned int h;
+  Object* obj;
+
+  if (scope->indexSize == 0) return NULL;
+  h = hashName(name, scope->indexSize);
+  while ((obj = scope->index[h]) != NULL) {
+    if (obj->name == name) return obj;
+    h = (h + 1) & (scope->indexSize - 1);
+  }
+  return NULL;
+}
+
 /******************* others ******************************/
 
 void initSymTab(void) {
   Object* obj;
   Object* param;
 
-  symtab = (SymTab*) malloc(sizeof(SymTab));
-  symtab->globalObjectList = NULL;
+  ctx->symtab = (SymTab*) arenaAlloc(&ctx->symtabArena, sizeof(SymTab));
+  ctx->symtab->globalObjectList = NULL;
+  ctx->symtab->currentScope = NULL;
+  ctx->symtab->program = NULL;
+
+  ctx->intType = makeBasicType(TP_INT);
+  ctx->charType = makeBasicType(TP_CHAR);
+  ctx->arrayTypes = NULL;
+  ctx->arrayTypesSize = 0;
+  ctx->arrayTypesCount = 0;
   
-  obj = createFunctionObject("READC");
+  obj = createFunctionObject(internString("READC", 5));
   obj->funcAttrs->returnType = makeCharType();
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(ctx->symtab->globalObjectList), obj);
 
-  obj = createFunctionObject("READI");
+  obj = createFunctionObject(internString("READI", 5));
   obj->funcAttrs->returnType = makeIntType();
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(ctx->symtab->globalObjectList), obj);
 
-  obj = createProcedureObject("WRITEI");
-  param = createParameterObject("i", PARAM_VALUE, obj);
+  obj = createProcedureObject(internString("WRITEI", 6));
+  param = createParameterObject(internString("i", 1), PARAM_VALUE, obj);
   param->paramAttrs->type = makeIntType();
   addObject(&(obj->procAttrs->paramList),param);
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(ctx->symtab->globalObjectList), obj);
 
-  obj = createProcedureObject("WRITEC");
-  param = createParameterObject("ch", PARAM_VALUE, obj);
+  obj = createProcedureObject(internString("WRITEC", 6));
+  param = createParameterObject(internString("ch", 2), PARAM_VALUE, obj);
   param->paramAttrs->type = makeCharType();
   addObject(&(obj->procAttrs->paramList),param);
-  addObject(&(symtab->globalObjectList), obj);
-
-  obj = createProcedureObject("WRITELN");
-  addObject(&(symtab->globalObjectList), obj);
+  addObject(&(ctx->symtab->globalObjectList), obj);
 
-  intType = makeIntType();
-  charType = makeCharType();
+  obj = createProcedureObject(internString("WRITELN", 7));
+  addObject(&(ctx->symtab->globalObjectList), obj);
 }
 
 void cleanSymTab(void) {
-  freeObject(symtab->program);
-  freeObjectList(symtab->globalObjectList);
-  free(symtab);
-  freeType(intType);
-  freeType(charType);
+  arenaReset(&ctx->symtabArena);
+  ctx->symtab = NULL;
+  ctx->intType = NULL;
+  ctx->charType = NULL;
+  ctx->arrayTypes = NULL;
 }
 
 void enterBlock(Scope* scope) {
-  symtab->currentScope = scope;
+  ctx->symtab->currentScope = scope;
 }
 
 void exitBlock(void) {
-  symtab->currentScope = symtab->currentScope->outer;
+  ctx->symtab->currentScope = ctx->symtab->currentScope->outer;
 }
 
 void declareObject(Object* obj) {
   if (obj->kind == OBJ_PARAMETER) {
-    Object* owner = symtab->currentScope->owner;
+    Object* owner = ctx->symtab->currentScope->owner;
     switch (owner->kind) {
     case OBJ_FUNCTION:
       addObject(&(owner->funcAttrs->paramList), obj);
@@ -328,7 +353,7 @@ void declareObject(Object* obj) {
     }
   }
  
-  addObject(&(symtab->currentScope->objList), obj);
+  addScopeObject(ctx->symtab->currentScope, obj);
 }
 
 
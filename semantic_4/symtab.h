@@ -8,6 +8,7 @@
 #define __SYMTAB_H__
 
 #include "token.h"
+#include "ast.h"
 
 enum TypeClass {
   TP_INT,
@@ -61,6 +62,8 @@ struct ConstantAttributes_ {
 struct VariableAttributes_ {
   Type *type;
   struct Scope_ *scope;
+  int localOffset;      // in its frame, set by the code generator
+  int nativeRegister;   // in the native code of its scope, 0 when none
 };
 
 struct TypeAttributes_ {
@@ -70,12 +73,14 @@ struct TypeAttributes_ {
 struct ProcedureAttributes_ {
   struct ObjectNode_ *paramList;
   struct Scope_* scope;
+  int codeAddress;
 };
 
 struct FunctionAttributes_ {
   struct ObjectNode_ *paramList;
   Type* returnType;
   struct Scope_ *scope;
+  int codeAddress;
 };
 
 struct ProgramAttributes_ {
@@ -86,6 +91,8 @@ struct ParameterAttributes_ {
   enum ParamKind kind;
   Type* type;
   struct Object_ *function;
+  int localOffset;
+  int nativeRegister;   // holding its value, or its address when a reference
 };
 
 typedef struct ConstantAttributes_ ConstantAttributes;
@@ -97,7 +104,7 @@ typedef struct ProgramAttributes_ ProgramAttributes;
 typedef struct ParameterAttributes_ ParameterAttributes;
 
 struct Object_ {
-  char name[MAX_IDENT_LEN];
+  char *name;           // interned
   enum ObjectKind kind;
   union {
     ConstantAttributes* constAttrs;
@@ -120,9 +127,16 @@ struct ObjectNode_ {
 typedef struct ObjectNode_ ObjectNode;
 
 struct Scope_ {
-  ObjectNode *objList;
+  ObjectNode *objList;  // objects in declaration order
+  ObjectNode *objTail;
+  Object **index;       // open addressing on the interned name, at most half full
+  int indexSize;
+  int objCount;
   Object *owner;
   struct Scope_ *outer;
+  NodeId body;          // the AST_BLOCK of the owner's statements
+  int level;            // nesting depth, 0 for the program
+  int frameSize;        // set by the code generator
 };
 
 typedef struct Scope_ Scope;
@@ -140,7 +154,7 @@ Type* makeCharType(void);
 Type* makeArrayType(int arraySize, Type* elementType);
 Type* duplicateType(Type* type);
 int compareType(Type* type1, Type* type2);
-void freeType(Type* type);
+int sizeOfType(Type* type);
 
 ConstantValue* makeIntConstant(int i);
 ConstantValue* makeCharConstant(char ch);
@@ -157,6 +171,7 @@ Object* createProcedureObject(char *name);
 Object* createParameterObject(char *name, enum ParamKind kind, Object* owner);
 
 Object* findObject(ObjectNode *objList, char *name);
+Object* findScopeObject(Scope *scope, char *name);
 
 void initSymTab(void);
 void cleanSymTab(void);
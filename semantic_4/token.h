@@ -28,13 +28,13 @@ typedef enum {
 
 typedef struct {
   char string[MAX_IDENT_LEN + 1];
+  char *ident;          // interned name of a TK_IDENT
   int lineNo, colNo;
   TokenType tokenType;
   int value;
 } Token;
 
 TokenType checkKeyword(char *string);
-Token* makeToken(TokenType tokenType, int lineNo, int colNo);
 char *tokenToString(TokenType tokenType);
 
 
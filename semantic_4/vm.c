@@ -0,0 +1,275 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vm.h"
+
+
+char *vmErrorMessages[] = {
+  [VM_OK] = "",
+  [VM_STACK_OVERFLOW] = "Stack overflow.",
+  [VM_INDEX_OUT_OF_RANGE] = "Index out of range.",
+  [VM_DIVISION_BY_ZERO] = "Division by zero.",
+  [VM_INVALID_INSTRUCTION] = "Invalid instruction."
+};
+
+typedef char vmErrorMessagesCheck[(sizeof(vmErrorMessages) / sizeof(vmErrorMessages[0]) == NUM_OF_VM_ERRORS) ? 1 : -1];
+
+int nextInputChar(Console* console) {
+  if (console->inPos == console->inSize) {
+    fflush(stdout);
+    console->inSize = fread(console->in, 1, IO_BUFFER_SIZE, stdin);
+    console->inPos = 0;
+    if (console->inSize <= 0) {
+      console->inSize = 0;
+      return EOF;
+    }
+  }
+  return (unsigned char) console->in[console->inPos ++];
+}
+
+int peekInputChar(Console* console) {
+  int c = nextInputChar(console);
+  if (c != EOF) console->inPos --;
+  return c;
+}
+
+void skipBlanks(Console* console) {
+  int c;
+  while (((c = peekInputChar(console)) == ' ') || (c == '\t') || (c == '\n') || (c == '\r'))
+    console->inPos ++;
+}
+
+// The next non-blank character, 0 at the end of the input
+WORD readCharacter(Console* console) {
+  int c;
+  skipBlanks(console);
+  c = nextInputChar(console);
+  return (c == EOF) ? 0 : c;
+}
+
+// The next integer, 0 when there is none
+WORD readInteger(Console* console) {
+  unsigned int value = 0;
+  int negative = 0;
+  int c;
+
+  skipBlanks(console);
+  c = peekInputChar(console);
+  if ((c == '-') || (c == '+')) {
+    negative = (c == '-');
+    console->inPos ++;
+  }
+  while (((c = peekInputChar(console)) >= '0') && (c <= '9')) {
+    value = value * 10 + (c - '0');
+    console->inPos ++;
+  }
+  return (WORD) (negative ? 0u - value : value);
+}
+
+void flushOutput(Console* console) {
+  fwrite(console->out, 1, console->outPos, stdout);
+  console->outPos = 0;
+}
+
+void writeCharacter(Console* console, int c) {
+  if (console->outPos == IO_BUFFER_SIZE)
+    flushOutput(console);
+  console->out[console->outPos ++] = (char) c;
+}
+
+// Integers are followed by a blank so that consecutive ones stay apart
+void writeInteger(Console* console, WORD value) {
+  char digits[16];
+  unsigned int v = (value < 0) ? 0u - (unsigned int) value : (unsigned int) value;
+  int n = 0;
+
+  do {
+    digits[n ++] = '0' + v % 10;
+    v /= 10;
+  } while (v != 0);
+  if (value < 0)
+    writeCharacter(console, '-');
+  while (n > 0)
+    writeCharacter(console, digits[-- n]);
+  writeCharacter(console, ' ');
+}
+
+/******************************************************************/
+
+VMResult runVM(CodeBlock* codeBlock, int stackSize) {
+  Instruction* code = codeBlock->code;
+  Instruction* inst;
+  WORD* s = (WORD*) calloc(stackSize, sizeof(WORD));
+  Console* console = (Console*) malloc(sizeof(Console));
+  int pc = 0;       // next instruction
+  int t = -1;       // top of the stack
+  int b = 0;        // base of the current frame
+  int base, level;
+  VMResult result = VM_OK;
+
+  console->inPos = console->inSize = 0;
+  console->outPos = 0;
+
+  for (;;) {
+    inst = &code[pc ++];
+    switch (inst->op) {
+    case OP_LA:
+      for (base = b, level = inst->p; level > 0; level --)
+        base = s[base + STATIC_LINK_OFFSET];
+      s[++ t] = base + inst->q;
+      break;
+    case OP_LV:
+      for (base = b, level = inst->p; level > 0; level --)
+        base = s[base + STATIC_LINK_OFFSET];
+      s[t + 1] = s[base + inst->q];
+      t ++;
+      break;
+    case OP_LC:
+      s[++ t] = inst->q;
+      break;
+    case OP_LI:
+      s[t] = s[s[t]];
+      break;
+    case OP_INT:
+      t += inst->q;
+      if (t + STACK_MARGIN >= stackSize) {
+        result = VM_STACK_OVERFLOW;
+        goto stop;
+      }
+      break;
+    case OP_DCT:
+      t -= inst->q;
+      break;
+    case OP_J:
+      pc = inst->q;
+      break;
+    case OP_FJ:
+      if (s[t --] == 0)
+        pc = inst->q;
+      break;
+    case OP_HL:
+      goto stop;
+    case OP_ST:
+      s[s[t - 1]] = s[t];
+      t -= 2;
+      break;
+    case OP_CALL:
+      for (base = b, level = inst->p; level > 0; level --)
+        base = s[base + STATIC_LINK_OFFSET];
+      s[t + 1 + DYNAMIC_LINK_OFFSET] = b;
+      s[t + 1 + RETURN_ADDRESS_OFFSET] = pc;
+      s[t + 1 + STATIC_LINK_OFFSET] = base;
+      b = t + 1;
+      pc = inst->q;
+      break;
+    case OP_EP:
+      t = b - 1;
+      pc = s[b + RETURN_ADDRESS_OFFSET];
+      b = s[b + DYNAMIC_LINK_OFFSET];
+      break;
+    case OP_EF:
+      t = b;
+      pc = s[b + RETURN_ADDRESS_OFFSET];
+      b = s[b + DYNAMIC_LINK_OFFSET];
+      break;
+    case OP_RC:
+      s[++ t] = readCharacter(console);
+      break;
+    case OP_RI:
+      s[++ t] = readInteger(console);
+      break;
+    case OP_WRC:
+      writeCharacter(console, s[t --]);
+      break;
+    case OP_WRI:
+      writeInteger(console, s[t --]);
+      break;
+    case OP_WLN:
+      writeCharacter(console, '\n');
+      break;
+    case OP_AD:
+      t --;
+      s[t] = (WORD) ((unsigned int) s[t] + (unsigned int) s[t + 1]);
+      break;
+    case OP_SB:
+      t --;
+      s[t] = (WORD) ((unsigned int) s[t] - (unsigned int) s[t + 1]);
+      break;
+    case OP_ML:
+      t --;
+      s[t] = (WORD) ((unsigned int) s[t] * (unsigned int) s[t + 1]);
+      break;
+    case OP_DV:
+      t --;
+      if (s[t + 1] == 0) {
+        result = VM_DIVISION_BY_ZERO;
+        goto stop;
+      }
+      if (s[t + 1] == -1)
+        s[t] = (WORD) (0u - (unsigned int) s[t]);
+      else s[t] = s[t] / s[t + 1];
+      break;
+    case OP_NEG:
+      s[t] = (WORD) (0u - (unsigned int) s[t]);
+      break;
+    case OP_CV:
+      s[t + 1] = s[t];
+      t ++;
+      break;
+    case OP_EQ:
+      t --;
+      s[t] = (s[t] == s[t + 1]);
+      break;
+    case OP_NE:
+      t --;
+      s[t] = (s[t] != s[t + 1]);
+      break;
+    case OP_GT:
+      t --;
+      s[t] = (s[t] > s[t + 1]);
+      break;
+    case OP_LT:
+      t --;
+      s[t] = (s[t] < s[t + 1]);
+      break;
+    case OP_GE:
+      t --;
+      s[t] = (s[t] >= s[t + 1]);
+      break;
+    case OP_LE:
+      t --;
+      s[t] = (s[t] <= s[t + 1]);
+      break;
+    case OP_CHK:
+      if ((s[t] < 1) || (s[t] > inst->q)) {
+        result = VM_INDEX_OUT_OF_RANGE;
+        goto stop;
+      }
+      break;
+    case OP_CP:
+      memmove(&s[s[t - 1]], &s[s[t]], inst->q * sizeof(WORD));
+      t -= 2;
+      break;
+    case OP_BP:
+      break;
+    default:
+      result = VM_INVALID_INSTRUCTION;
+      goto stop;
+    }
+  }
+
+ stop:
+  flushOutput(console);
+  fflush(stdout);
+  if (result != VM_OK)
+    fprintf(stderr, "%d: Runtime error: %s\n", codeBlock->lineNos[pc - 1], vmErrorMessages[result]);
+  free(console);
+  free(s);
+  return result;
+}
@@ -0,0 +1,51 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __VM_H__
+#define __VM_H__
+
+#include "instructions.h"
+
+#define DEFAULT_STACK_SIZE (1 << 20)    // in words
+
+typedef enum {
+  VM_OK,
+  VM_STACK_OVERFLOW,
+  VM_INDEX_OUT_OF_RANGE,
+  VM_DIVISION_BY_ZERO,
+  VM_INVALID_INSTRUCTION,
+  NUM_OF_VM_ERRORS      // number of results, keep last
+} VMResult;
+
+// Words an expression may push on top of the current frame. Frames are only
+// checked against the stack size when they are created.
+#define STACK_MARGIN 4096
+
+#define IO_BUFFER_SIZE 65536
+
+// Buffered console of one run
+struct Console_ {
+  char in[IO_BUFFER_SIZE];
+  int inPos, inSize;
+  char out[IO_BUFFER_SIZE];
+  int outPos;
+};
+
+typedef struct Console_ Console;
+
+extern char *vmErrorMessages[];
+
+WORD readCharacter(Console* console);
+WORD readInteger(Console* console);
+void writeCharacter(Console* console, int c);
+void writeInteger(Console* console, WORD value);
+void flushOutput(Console* console);
+
+// Runs the code reading from stdin and writing to stdout. A runtime error is
+// reported on stderr with the source line of the failing instruction.
+VMResult runVM(CodeBlock* codeBlock, int stackSize);
+
+#endif
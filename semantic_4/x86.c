@@ -0,0 +1,504 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "x86.h"
+#include "context.h"
+
+#define CODE_INITIAL_SIZE 4096
+
+char *registerNames64[] = {
+  "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+  "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+};
+
+char *registerNames32[] = {
+  "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+  "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"
+};
+
+char *registerNames8[] = {
+  "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+  "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"
+};
+
+char *conditionNames[] = {
+  [X86_E] = "e", [X86_NE] = "ne",
+  [X86_L] = "l", [X86_GE] = "ge",
+  [X86_LE] = "le", [X86_G] = "g",
+  [X86_B] = "b", [X86_AE] = "ae",
+  [X86_BE] = "be", [X86_A] = "a"
+};
+
+// The low nibble of the Jcc and SETcc opcodes
+int conditionCodes[] = {
+  [X86_E] = 0x4, [X86_NE] = 0x5,
+  [X86_L] = 0xC, [X86_GE] = 0xD,
+  [X86_LE] = 0xE, [X86_G] = 0xF,
+  [X86_B] = 0x2, [X86_AE] = 0x3,
+  [X86_BE] = 0x6, [X86_A] = 0x7
+};
+
+char *x86OpNames[] = {
+  [X86_MOV] = "mov",
+  [X86_ADD] = "add",
+  [X86_SUB] = "sub",
+  [X86_IMUL] = "imul",
+  [X86_CMP] = "cmp",
+  [X86_TEST] = "test"
+};
+
+// Opcode of "op r/m, reg", and the /digit of "op r/m, imm"
+int x86OpCodes[] = {
+  [X86_MOV] = 0x89,
+  [X86_ADD] = 0x01,
+  [X86_SUB] = 0x29,
+  [X86_IMUL] = 0,
+  [X86_CMP] = 0x39,
+  [X86_TEST] = 0x85
+};
+
+int x86OpDigits[] = {
+  [X86_MOV] = 0,
+  [X86_ADD] = 0,
+  [X86_SUB] = 5,
+  [X86_IMUL] = 0,
+  [X86_CMP] = 7,
+  [X86_TEST] = 0
+};
+
+char *routineNames[] = {
+  [RT_READC] = "kpl_readc",
+  [RT_READI] = "kpl_readi",
+  [RT_WRITEC] = "kpl_writec",
+  [RT_WRITEI] = "kpl_writei",
+  [RT_WRITELN] = "kpl_writeln",
+  [RT_ERROR] = "kpl_error"
+};
+
+typedef char registerNamesCheck[(sizeof(registerNames8) / sizeof(registerNames8[0]) == NUM_OF_X86_REGISTERS) ? 1 : -1];
+typedef char conditionNamesCheck[(sizeof(conditionNames) / sizeof(conditionNames[0]) == NUM_OF_X86_CONDITIONS) ? 1 : -1];
+typedef char conditionCodesCheck[(sizeof(conditionCodes) / sizeof(conditionCodes[0]) == NUM_OF_X86_CONDITIONS) ? 1 : -1];
+typedef char x86OpNamesCheck[(sizeof(x86OpNames) / sizeof(x86OpNames[0]) == NUM_OF_X86_OPS) ? 1 : -1];
+typedef char x86OpDigitsCheck[(sizeof(x86OpDigits) / sizeof(x86OpDigits[0]) == NUM_OF_X86_OPS) ? 1 : -1];
+typedef char routineNamesCheck[(sizeof(routineNames) / sizeof(routineNames[0]) == NUM_OF_ROUTINES) ? 1 : -1];
+
+#define TEXT (ctx->native.text != NULL)
+
+static void instruction(const char* format, ...) {
+  va_list args;
+
+  fputc('\t', ctx->native.text);
+  va_start(args, format);
+  vfprintf(ctx->native.text, format, args);
+  va_end(args);
+  fputc('\n', ctx->native.text);
+}
+
+static char* reg(int size, enum X86Register r) {
+  return (size == 8) ? registerNames64[r] : registerNames32[r];
+}
+
+static char suffix(int size) {
+  return (size == 8) ? 'q' : 'l';
+}
+
+/******************************************************************/
+
+static void emitByte(int b) {
+  X86Code* code = &ctx->native;
+
+  if (code->size == code->capacity) {
+    code->capacity = (code->capacity == 0) ? CODE_INITIAL_SIZE : code->capacity * 2;
+    code->bytes = (unsigned char*) realloc(code->bytes, code->capacity);
+  }
+  code->bytes[code->size ++] = (unsigned char) b;
+}
+
+static void emitInt32(WORD value) {
+  unsigned int v = (unsigned int) value;
+  int i;
+
+  for (i = 0; i < 4; i ++, v >>= 8)
+    emitByte(v & 0xFF);
+}
+
+static void addFixup(enum X86FixupKind kind, int target) {
+  X86Code* code = &ctx->native;
+
+  if (code->fixupCount == code->fixupCapacity) {
+    code->fixupCapacity = (code->fixupCapacity == 0) ? 256 : code->fixupCapacity * 2;
+    code->fixups = (X86Fixup*) realloc(code->fixups, code->fixupCapacity * sizeof(X86Fixup));
+  }
+  code->fixups[code->fixupCount].offset = code->size;
+  code->fixups[code->fixupCount].kind = kind;
+  code->fixups[code->fixupCount].target = target;
+  code->fixupCount ++;
+}
+
+// A rel32 to a label, resolved by x86Finish
+static void emitLabelRef(X86Label label) {
+  addFixup(FIX_LABEL, label);
+  emitInt32(0);
+}
+
+// movabs $address, %r11, the address filled in by x86Relocate
+static void emitAddressToR11(enum X86FixupKind kind, int target) {
+  emitByte(0x49);
+  emitByte(0xBB);
+  addFixup(kind, target);
+  emitInt32(0);
+  emitInt32(0);
+}
+
+// The REX prefix, when one is needed or forced (for spl, bpl, sil and dil)
+static void emitRex(int wide, int r, int b, int force) {
+  int rex = 0x40 | (wide ? 0x08 : 0) | ((r & 8) ? 0x04 : 0) | ((b & 8) ? 0x01 : 0);
+
+  if ((rex != 0x40) || force)
+    emitByte(rex);
+}
+
+static void emitModRMReg(int r, int rm) {
+  emitByte(0xC0 | ((r & 7) << 3) | (rm & 7));
+}
+
+// disp(%base); %rsp and %r12 need a SIB byte, %rbp and %r13 a displacement
+static void emitModRMMem(int r, enum X86Register base, int disp) {
+  int mod;
+
+  if ((disp == 0) && ((base & 7) != X86_RBP))
+    mod = 0x00;
+  else if ((disp >= -128) && (disp <= 127))
+    mod = 0x40;
+  else mod = 0x80;
+
+  emitByte(mod | ((r & 7) << 3) | (base & 7));
+  if ((base & 7) == X86_RSP)
+    emitByte(0x24);
+  if (mod == 0x40)
+    emitByte(disp & 0xFF);
+  else if (mod == 0x80)
+    emitInt32(disp);
+}
+
+static int fitsByte(WORD value) {
+  return (value >= -128) && (value <= 127);
+}
+
+/******************************************************************/
+
+void x86Begin(FILE* text) {
+  X86Code* code = &ctx->native;
+
+  code->text = text;
+  code->size = 0;
+  code->entry = 0;
+  code->labelCount = 0;
+  code->fixupCount = 0;
+  if (TEXT)
+    instruction(".text");
+}
+
+void x86Finish(void) {
+  X86Code* code = &ctx->native;
+  X86Fixup* fixup;
+  WORD rel;
+  int i;
+
+  // the stack of the linked program is not executable
+  if (TEXT) {
+    fprintf(ctx->native.text, "\n");
+    instruction(".section .note.GNU-stack,\"\",@progbits");
+    return;
+  }
+  for (i = 0; i < code->fixupCount; i ++) {
+    fixup = &code->fixups[i];
+    if (fixup->kind == FIX_LABEL) {
+      rel = code->labels[fixup->target] - (fixup->offset + 4);
+      memcpy(code->bytes + fixup->offset, &rel, 4);
+    }
+  }
+}
+
+void x86Relocate(X86Code* code, unsigned char* image, void* routines[], void* stackLimit) {
+  X86Fixup* fixup;
+  void* address;
+  int i;
+
+  for (i = 0; i < code->fixupCount; i ++) {
+    fixup = &code->fixups[i];
+    if (fixup->kind == FIX_LABEL)
+      continue;
+    address = (fixup->kind == FIX_ROUTINE) ? routines[fixup->target] : stackLimit;
+    memcpy(image + fixup->offset, &address, sizeof(void*));
+  }
+}
+
+void freeX86Code(X86Code* code) {
+  free(code->bytes);
+  free(code->labels);
+  free(code->fixups);
+  code->bytes = NULL;
+  code->labels = NULL;
+  code->fixups = NULL;
+  code->size = code->capacity = 0;
+  code->labelCount = code->labelCapacity = 0;
+  code->fixupCount = code->fixupCapacity = 0;
+}
+
+X86Label x86NewLabel(void) {
+  X86Code* code = &ctx->native;
+
+  if (!TEXT && (code->labelCount + 1 >= code->labelCapacity)) {
+    code->labelCapacity = (code->labelCapacity == 0) ? 256 : code->labelCapacity * 2;
+    code->labels = (int*) realloc(code->labels, code->labelCapacity * sizeof(int));
+  }
+  return ++ code->labelCount;
+}
+
+void x86Label(X86Label label) {
+  if (TEXT)
+    fprintf(ctx->native.text, ".L%d:\n", label);
+  else ctx->native.labels[label] = ctx->native.size;
+}
+
+void x86Function(X86Label label, char* name) {
+  if (TEXT)
+    fprintf(ctx->native.text, "\n# %s\n", name);
+  x86Label(label);
+}
+
+void x86Global(char* symbol) {
+  if (TEXT) {
+    fprintf(ctx->native.text, "\n");
+    instruction(".globl %s", symbol);
+    fprintf(ctx->native.text, "%s:\n", symbol);
+  } else ctx->native.entry = ctx->native.size;
+}
+
+void x86MovImm(enum X86Register r, WORD value) {
+  if (TEXT) {
+    instruction("movl $%d, %%%s", value, registerNames32[r]);
+    return;
+  }
+  emitRex(0, 0, r, 0);
+  emitByte(0xB8 + (r & 7));
+  emitInt32(value);
+}
+
+void x86Load(int size, enum X86Register r, enum X86Register base, int disp) {
+  if (TEXT) {
+    instruction("mov%c %d(%%%s), %%%s", suffix(size), disp, registerNames64[base], reg(size, r));
+    return;
+  }
+  emitRex(size == 8, r, base, 0);
+  emitByte(0x8B);
+  emitModRMMem(r, base, disp);
+}
+
+void x86Store(int size, enum X86Register base, int disp, enum X86Register r) {
+  if (TEXT) {
+    instruction("mov%c %%%s, %d(%%%s)", suffix(size), reg(size, r), disp, registerNames64[base]);
+    return;
+  }
+  emitRex(size == 8, r, base, 0);
+  emitByte(0x89);
+  emitModRMMem(r, base, disp);
+}
+
+void x86Lea(enum X86Register r, enum X86Register base, int disp) {
+  if (TEXT) {
+    instruction("leaq %d(%%%s), %%%s", disp, registerNames64[base], registerNames64[r]);
+    return;
+  }
+  emitRex(1, r, base, 0);
+  emitByte(0x8D);
+  emitModRMMem(r, base, disp);
+}
+
+void x86Op(enum X86Op op, int size, enum X86Register dst, enum X86Register src) {
+  if (TEXT) {
+    instruction("%s%c %%%s, %%%s", x86OpNames[op], suffix(size), reg(size, src), reg(size, dst));
+    return;
+  }
+  if (op == X86_IMUL) {
+    emitRex(size == 8, dst, src, 0);
+    emitByte(0x0F);
+    emitByte(0xAF);
+    emitModRMReg(dst, src);
+  } else {
+    emitRex(size == 8, src, dst, 0);
+    emitByte(x86OpCodes[op]);
+    emitModRMReg(src, dst);
+  }
+}
+
+// op is X86_ADD, X86_SUB, X86_CMP or X86_IMUL
+void x86OpImm(enum X86Op op, int size, enum X86Register r, WORD value) {
+  if (TEXT) {
+    if (op == X86_IMUL)
+      instruction("imul%c $%d, %%%s, %%%s", suffix(size), value, reg(size, r), reg(size, r));
+    else instruction("%s%c $%d, %%%s", x86OpNames[op], suffix(size), value, reg(size, r));
+    return;
+  }
+  if (op == X86_IMUL) {
+    emitRex(size == 8, r, r, 0);
+    emitByte(fitsByte(value) ? 0x6B : 0x69);
+    emitModRMReg(r, r);
+  } else {
+    emitRex(size == 8, 0, r, 0);
+    emitByte(fitsByte(value) ? 0x83 : 0x81);
+    emitModRMReg(x86OpDigits[op], r);
+  }
+  if (fitsByte(value))
+    emitByte(value & 0xFF);
+  else emitInt32(value);
+}
+
+void x86Neg(enum X86Register r) {
+  if (TEXT) {
+    instruction("negl %%%s", registerNames32[r]);
+    return;
+  }
+  emitRex(0, 0, r, 0);
+  emitByte(0xF7);
+  emitModRMReg(3, r);
+}
+
+void x86Cltd(void) {
+  if (TEXT)
+    instruction("cltd");
+  else emitByte(0x99);
+}
+
+void x86Idiv(enum X86Register r) {
+  if (TEXT) {
+    instruction("idivl %%%s", registerNames32[r]);
+    return;
+  }
+  emitRex(0, 0, r, 0);
+  emitByte(0xF7);
+  emitModRMReg(7, r);
+}
+
+void x86Setcc(enum X86Condition cond, enum X86Register r) {
+  if (TEXT) {
+    instruction("set%s %%%s", conditionNames[cond], registerNames8[r]);
+    instruction("movzbl %%%s, %%%s", registerNames8[r], registerNames32[r]);
+    return;
+  }
+  emitRex(0, 0, r, r >= 4);
+  emitByte(0x0F);
+  emitByte(0x90 + conditionCodes[cond]);
+  emitModRMReg(0, r);
+  emitRex(0, r, r, r >= 4);
+  emitByte(0x0F);
+  emitByte(0xB6);
+  emitModRMReg(r, r);
+}
+
+void x86Push(enum X86Register r) {
+  if (TEXT) {
+    instruction("pushq %%%s", registerNames64[r]);
+    return;
+  }
+  emitRex(0, 0, r, 0);
+  emitByte(0x50 + (r & 7));
+}
+
+void x86Pop(enum X86Register r) {
+  if (TEXT) {
+    instruction("popq %%%s", registerNames64[r]);
+    return;
+  }
+  emitRex(0, 0, r, 0);
+  emitByte(0x58 + (r & 7));
+}
+
+// Copies ecx words from (rsi) to (rdi)
+void x86CopyWords(void) {
+  if (TEXT) {
+    instruction("rep movsq");
+    return;
+  }
+  emitByte(0xF3);
+  emitByte(0x48);
+  emitByte(0xA5);
+}
+
+// Sets the flags for %rsp - kpl_stacklimit (an address below which the
+// runtime has no stack left)
+void x86CompareStackLimit(void) {
+  if (TEXT) {
+    instruction("cmpq kpl_stacklimit(%%rip), %%rsp");
+    return;
+  }
+  emitAddressToR11(FIX_STACK_LIMIT, 0);
+  emitByte(0x49);           // cmpq (%r11), %rsp
+  emitByte(0x3B);
+  emitByte(0x23);
+}
+
+void x86Jmp(X86Label label) {
+  if (TEXT) {
+    instruction("jmp .L%d", label);
+    return;
+  }
+  emitByte(0xE9);
+  emitLabelRef(label);
+}
+
+void x86Jcc(enum X86Condition cond, X86Label label) {
+  if (TEXT) {
+    instruction("j%s .L%d", conditionNames[cond], label);
+    return;
+  }
+  emitByte(0x0F);
+  emitByte(0x80 + conditionCodes[cond]);
+  emitLabelRef(label);
+}
+
+void x86Call(X86Label label) {
+  if (TEXT) {
+    instruction("call .L%d", label);
+    return;
+  }
+  emitByte(0xE8);
+  emitLabelRef(label);
+}
+
+// Machine code calls C functions, which need a 16-byte aligned stack:
+//   pushq %rsp; pushq (%rsp); andq $-16, %rsp
+//   movabs $routine, %r11; call *%r11; movq 8(%rsp), %rsp
+void x86CallRuntime(enum RuntimeRoutine routine) {
+  static const unsigned char align[] = {0x54, 0xFF, 0x34, 0x24, 0x48, 0x83, 0xE4, 0xF0};
+  static const unsigned char restore[] = {0x41, 0xFF, 0xD3, 0x48, 0x8B, 0x64, 0x24, 0x08};
+  unsigned int i;
+
+  if (TEXT) {
+    instruction("call %s", routineNames[routine]);
+    return;
+  }
+  for (i = 0; i < sizeof(align); i ++)
+    emitByte(align[i]);
+  emitAddressToR11(FIX_ROUTINE, routine);
+  for (i = 0; i < sizeof(restore); i ++)
+    emitByte(restore[i]);
+}
+
+void x86Ret(void) {
+  if (TEXT)
+    instruction("ret");
+  else emitByte(0xC3);
+}
+
+enum X86Condition x86Negate(enum X86Condition cond) {
+  return cond ^ 1;
+}
@@ -0,0 +1,126 @@
+/* 
+ * @copyright (c) 2008, Hedspi, Hanoi University of Technology
+ * @author Huu-Duc Nguyen
+ * @version 1.0
+ */
+
+#ifndef __X86_H__
+#define __X86_H__
+
+#include <stdio.h>
+#include "instructions.h"
+
+// The few x86-64 instructions the native code generator needs, written out
+// in GNU assembler syntax or assembled into machine code
+
+enum X86Register {
+  X86_RAX, X86_RCX, X86_RDX, X86_RBX, X86_RSP, X86_RBP, X86_RSI, X86_RDI,
+  X86_R8, X86_R9, X86_R10, X86_R11, X86_R12, X86_R13, X86_R14, X86_R15
+};
+
+#define NUM_OF_X86_REGISTERS (X86_R15 + 1)
+
+// Each condition is next to its negation
+enum X86Condition {
+  X86_E, X86_NE,          // equal, not equal
+  X86_L, X86_GE,          // signed
+  X86_LE, X86_G,
+  X86_B, X86_AE,          // unsigned
+  X86_BE, X86_A
+};
+
+#define NUM_OF_X86_CONDITIONS (X86_A + 1)
+
+enum X86Op {
+  X86_MOV,
+  X86_ADD,
+  X86_SUB,
+  X86_IMUL,
+  X86_CMP,
+  X86_TEST
+};
+
+#define NUM_OF_X86_OPS (X86_TEST + 1)
+
+// Routines of the runtime (kplrt.s)
+enum RuntimeRoutine {
+  RT_READC,         // eax := next character
+  RT_READI,         // eax := next integer
+  RT_WRITEC,        // write the character in edi
+  RT_WRITEI,        // write the integer in edi
+  RT_WRITELN,       // write a new line
+  RT_ERROR          // report runtime error esi at line edi and exit
+};
+
+#define NUM_OF_ROUTINES (RT_ERROR + 1)
+
+typedef int X86Label;
+
+enum X86FixupKind {
+  FIX_LABEL,            // rel32 to a label
+  FIX_ROUTINE,          // absolute address of a runtime routine
+  FIX_STACK_LIMIT       // absolute address of the stack limit
+};
+
+struct X86Fixup_ {
+  int offset;
+  enum X86FixupKind kind;
+  int target;
+};
+
+typedef struct X86Fixup_ X86Fixup;
+
+struct X86Code_ {
+  FILE* text;               // the assembly is written here, or when NULL
+  unsigned char* bytes;     // the machine code is assembled here
+  int size;
+  int capacity;
+  int entry;                // offset of kpl_main
+  int* labels;              // offset of each label
+  int labelCount;
+  int labelCapacity;
+  X86Fixup* fixups;
+  int fixupCount;
+  int fixupCapacity;
+};
+
+typedef struct X86Code_ X86Code;
+
+// Starts writing assembly to text, or assembling machine code when text is NULL
+void x86Begin(FILE* text);
+// Resolves the jumps and calls of the machine code, or ends the assembly
+void x86Finish(void);
+// Fills in the absolute addresses of a copy of the machine code
+void x86Relocate(X86Code* code, unsigned char* image, void* routines[], void* stackLimit);
+void freeX86Code(X86Code* code);
+
+X86Label x86NewLabel(void);
+void x86Label(X86Label label);
+void x86Function(X86Label label, char* name);
+void x86Global(char* symbol);
+
+// size is 4 or 8 bytes
+void x86MovImm(enum X86Register reg, WORD value);
+void x86Load(int size, enum X86Register reg, enum X86Register base, int disp);
+void x86Store(int size, enum X86Register base, int disp, enum X86Register reg);
+void x86Lea(enum X86Register reg, enum X86Register base, int disp);
+void x86Op(enum X86Op op, int size, enum X86Register dst, enum X86Register src);
+void x86OpImm(enum X86Op op, int size, enum X86Register reg, WORD value);
+void x86Neg(enum X86Register reg);
+void x86Cltd(void);
+void x86Idiv(enum X86Register reg);
+void x86Setcc(enum X86Condition cond, enum X86Register reg);
+void x86Push(enum X86Register reg);
+void x86Pop(enum X86Register reg);
+void x86CopyWords(void);
+void x86CompareStackLimit(void);
+
+void x86Jmp(X86Label label);
+void x86Jcc(enum X86Condition cond, X86Label label);
+void x86Call(X86Label label);
+void x86CallRuntime(enum RuntimeRoutine routine);
+void x86Ret(void);
+
+enum X86Condition x86Negate(enum X86Condition cond);
+
+#endif
@@ -8,54 +8,54 @@
 #include <stdlib.h>
 #include "error.h"
 
-#define NUM_OF_ERRORS 32
-
-struct ErrorMessage {
-  ErrorCode errorCode;
-  char *message;
+// Messages are indexed by error code
+char *errorMessages[] = {
+  [ERR_END_OF_COMMENT] = "End of comment expected.",
+  [ERR_IDENT_TOO_LONG] = "Identifier too long.",
+  [ERR_INVALID_CONSTANT_CHAR] = "Invalid char constant.",
+  [ERR_INVALID_SYMBOL] = "Invalid symbol.",
+  [ERR_INVALID_IDENT] = "An identifier expected.",
+  [ERR_INVALID_CONSTANT] = "A constant expected.",
+  [ERR_INVALID_TYPE] = "A type expected.",
+  [ERR_INVALID_BASICTYPE] = "A basic type expected.",
+  [ERR_INVALID_VARIABLE] = "A variable expected.",
+  [ERR_INVALID_FUNCTION] = "A function identifier expected.",
+  [ERR_INVALID_PROCEDURE] = "A procedure identifier expected.",
+  [ERR_INVALID_PARAMETER] = "A parameter expected.",
+  [ERR_INVALID_STATEMENT] = "Invalid statement.",
+  [ERR_INVALID_COMPARATOR] = "A comparator expected.",
+  [ERR_INVALID_EXPRESSION] = "Invalid expression.",
+  [ERR_INVALID_TERM] = "Invalid term.",
+  [ERR_INVALID_FACTOR] = "Invalid factor.",
+  [ERR_INVALID_LVALUE] = "Invalid lvalue in assignment.",
+  [ERR_INVALID_ARGUMENTS] = "Wrong arguments.",
+  [ERR_UNDECLARED_IDENT] = "Undeclared identifier.",
+  [ERR_UNDECLARED_CONSTANT] = "Undeclared constant.",
+  [ERR_UNDECLARED_INT_CONSTANT] = "Undeclared integer constant.",
+  [ERR_UNDECLARED_TYPE] = "Undeclared type.",
+  [ERR_UNDECLARED_VARIABLE] = "Undeclared variable.",
+  [ERR_UNDECLARED_FUNCTION] = "Undeclared function.",
+  [ERR_UNDECLARED_PROCEDURE] = "Undeclared procedure.",
+  [ERR_DUPLICATE_IDENT] = "Duplicate identifier.",
+  [ERR_TYPE_INCONSISTENCY] = "Type inconsistency",
+  [ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY] = "The number of arguments and the number of parameters are inconsistent.",
+  [ERR_FLOAT_INDEX_FOR_STATEMENT] = "Wrong float index for FOR statement.",
+  [ERR_MODULO_OPERATOR_CANNOT_USE] = "Cannot use real number with modulo operator"
 };
 
-struct ErrorMessage errors[NUM_OF_ERRORS] = {
-  {ERR_END_OF_COMMENT, "End of comment expected."},
-  {ERR_IDENT_TOO_LONG, "Identifier too long."},
-  {ERR_INVALID_CONSTANT_CHAR, "Invalid char constant."},
-  {ERR_INVALID_SYMBOL, "Invalid symbol."},
-  {ERR_INVALID_IDENT, "An identifier expected."},
-  {ERR_INVALID_CONSTANT, "A constant expected."},
-  {ERR_INVALID_TYPE, "A type expected."},
-  {ERR_INVALID_BASICTYPE, "A basic type expected."},
-  {ERR_INVALID_VARIABLE, "A variable expected."},
-  {ERR_INVALID_FUNCTION, "A function identifier expected."},
-  {ERR_INVALID_PROCEDURE, "A procedure identifier expected."},
-  {ERR_INVALID_PARAMETER, "A parameter expected."},
-  {ERR_INVALID_STATEMENT, "Invalid statement."},
-  {ERR_INVALID_COMPARATOR, "A comparator expected."},
-  {ERR_INVALID_EXPRESSION, "Invalid expression."},
-  {ERR_INVALID_TERM, "Invalid term."},
-  {ERR_INVALID_FACTOR, "Invalid factor."},
-  {ERR_INVALID_LVALUE, "Invalid lvalue in assignment."},
-  {ERR_INVALID_ARGUMENTS, "Wrong arguments."},
-  {ERR_UNDECLARED_IDENT, "Undeclared identifier."},
-  {ERR_UNDECLARED_CONSTANT, "Undeclared constant."},
-  {ERR_UNDECLARED_INT_CONSTANT, "Undeclared integer constant."},
-  {ERR_UNDECLARED_TYPE, "Undeclared type."},
-  {ERR_UNDECLARED_VARIABLE, "Undeclared variable."},
-  {ERR_UNDECLARED_FUNCTION, "Undeclared function."},
-  {ERR_UNDECLARED_PROCEDURE, "Undeclared procedure."},
-  {ERR_DUPLICATE_IDENT, "Duplicate identifier."},
-  {ERR_TYPE_INCONSISTENCY, "Type inconsistency"},
-  {ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY, "The number of arguments and the number of parameters are inconsistent."},
-  {ERR_FLOAT_INDEX_FOR_STATEMENT, "Wrong float index for FOR statement."},
-  {ERR_MODULO_OPERATOR_CANNOT_USE, "Cannot use real number with modulo operator"}
-};
+// Fails to compile unless the table reaches the last error code; a code
+// added in the middle without a message gets the fallback below
+typedef char errorMessagesCheck[(sizeof(errorMessages) / sizeof(errorMessages[0]) == NUM_OF_ERRORS) ? 1 : -1];
+
+static char *errorMessage(ErrorCode err) {
+  if (((unsigned) err >= NUM_OF_ERRORS) || (errorMessages[err] == NULL))
+    return "Unknown error.";
+  return errorMessages[err];
+}
 
 void error(ErrorCode err, int lineNo, int colNo) {
-  int i;
-  for (i = 0 ; i < NUM_OF_ERRORS; i ++) 
-    if (errors[i].errorCode == err) {
-      printf("%d-%d:%s\n", lineNo, colNo, errors[i].message);
-      exit(0);
-    }
+  printf("%d-%d:%s\n", lineNo, colNo, errorMessage(err));
+  exit(0);
 }
 
 void missingToken(TokenType tokenType, int lineNo, int colNo) {
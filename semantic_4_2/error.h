@@ -39,7 +39,8 @@ typedef enum {
   ERR_TYPE_INCONSISTENCY,
   ERR_PARAMETERS_ARGUMENTS_INCONSISTENCY,
   ERR_FLOAT_INDEX_FOR_STATEMENT,
-  ERR_MODULO_OPERATOR_CANNOT_USE
+  ERR_MODULO_OPERATOR_CANNOT_USE,
+  NUM_OF_ERRORS      // number of error codes, keep last
 } ErrorCode;
 
 void error(ErrorCode err, int lineNo, int colNo);
@@ -5,34 +5,61 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include "token.h"
 
+// Keywords are found with a perfect hash on the length and the first and
+// last characters: len + keywordAsso[first] + keywordAsso[last].
+// Characters that never start or end a keyword map to KEYWORD_HASH_SIZE,
+// so any word containing them at either end misses without a compare.
+#define KEYWORD_HASH_SIZE 32
+#define MAX_KEYWORD_LEN 9
+
+static const unsigned char keywordAsso[256] = {
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32,  8, 13,  5,  5,  7, 19, 32, 32,  6, 32, 32,  7,  8,  2,  5,
+   7, 32,  8, 32,  0, 32, 17,  7, 32,  1, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32,
+  32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32, 32
+};
+
 struct {
   char string[MAX_IDENT_LEN + 1];
   TokenType tokenType;
-} keywords[KEYWORDS_COUNT] = {
-  {"PROGRAM", KW_PROGRAM},
-  {"CONST", KW_CONST},
-  {"TYPE", KW_TYPE},
-  {"VAR", KW_VAR},
-  {"INTEGER", KW_INTEGER},
-  {"CHAR", KW_CHAR},
-  {"ARRAY", KW_ARRAY},
-  {"OF", KW_OF},
-  {"FUNCTION", KW_FUNCTION},
-  {"PROCEDURE", KW_PROCEDURE},
-  {"BEGIN", KW_BEGIN},
-  {"END", KW_END},
-  {"CALL", KW_CALL},
-  {"IF", KW_IF},
-  {"THEN", KW_THEN},
-  {"ELSE", KW_ELSE},
-  {"WHILE", KW_WHILE},
-  {"DO", KW_DO},
-  {"FOR", KW_FOR},
-  {"TO", KW_TO},
-  {"FLOAT", KW_FLOAT}
+} keywords[KEYWORD_HASH_SIZE] = {
+  [6] = {"THEN", KW_THEN},
+  [7] = {"TO", KW_TO},
+  [10] = {"CONST", KW_CONST},
+  [11] = {"TYPE", KW_TYPE},
+  [12] = {"DO", KW_DO},
+  [14] = {"ARRAY", KW_ARRAY},
+  [15] = {"END", KW_END},
+  [16] = {"CALL", KW_CALL},
+  [17] = {"CHAR", KW_CHAR},
+  [18] = {"ELSE", KW_ELSE},
+  [19] = {"WHILE", KW_WHILE},
+  [20] = {"BEGIN", KW_BEGIN},
+  [21] = {"INTEGER", KW_INTEGER},
+  [22] = {"PROGRAM", KW_PROGRAM},
+  [23] = {"PROCEDURE", KW_PROCEDURE},
+  [24] = {"FLOAT", KW_FLOAT},
+  [26] = {"OF", KW_OF},
+  [27] = {"IF", KW_IF},
+  [28] = {"VAR", KW_VAR},
+  [29] = {"FUNCTION", KW_FUNCTION},
+  [30] = {"FOR", KW_FOR}
 };
 
 int keywordEq(char *kw, char *string) {
@@ -44,10 +71,14 @@ int keywordEq(char *kw, char *string) {
 }
 
 TokenType checkKeyword(char *string) {
-  int i;
-  for (i = 0; i < KEYWORDS_COUNT; i++)
-    if (keywordEq(keywords[i].string, string)) 
-      return keywords[i].tokenType;
+  int len = strlen(string);
+  int h;
+
+  if ((len < 2) || (len > MAX_KEYWORD_LEN))
+    return TK_NONE;
+  h = len + keywordAsso[(unsigned char) string[0]] + keywordAsso[(unsigned char) string[len - 1]];
+  if ((h < KEYWORD_HASH_SIZE) && keywordEq(keywords[h].string, string))
+    return keywords[h].tokenType;
   return TK_NONE;
 }
 